@@ -0,0 +1,206 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace AP
+{
+    //Session memory for order pools, indexes and price level maps. Memory is carved out of large blocks by
+    //bumping a pointer. Freed chunks go onto per-size-class free lists and are handed out again by the next
+    //allocation of the same class. Nothing is returned to the system until release() or the destructor, which
+    //frees every block at once.
+    //Not thread-safe: give each thread (or each AuctionPrices owned by a thread) its own arena.
+    class arena
+    {
+        private:
+            struct block
+            {
+                block* next;
+                std::size_t size;
+            };
+            struct free_chunk
+            {
+                free_chunk* next;
+            };
+
+            //chunk sizes are powers of two from 16 bytes up
+            static constexpr int num_classes = 48;
+            static constexpr std::size_t min_chunk = 16;
+
+            block* blocks;
+            char* cursor;
+            char* limit;
+            std::size_t block_size;
+            std::size_t reserved;
+            free_chunk* free_lists[num_classes];
+
+            static int sizeClass(std::size_t bytes)
+            {
+                if(bytes <= min_chunk)
+                {
+                    return 0;
+                }
+                return 64 - __builtin_clzll(bytes - 1) - 4;
+            }
+
+            char* newBlock(std::size_t bytes)
+            {
+                block* b = static_cast<block*>(::operator new(sizeof(block) + min_chunk + bytes));
+                b->next = blocks;
+                b->size = bytes;
+                blocks = b;
+                reserved += bytes;
+
+                //keep chunks 16-byte aligned
+                std::uintptr_t start = reinterpret_cast<std::uintptr_t>(b + 1);
+                start = (start + min_chunk - 1) & ~static_cast<std::uintptr_t>(min_chunk - 1);
+                return reinterpret_cast<char*>(start);
+            }
+
+        public:
+            explicit arena(std::size_t block_size = 1 << 20)
+                : blocks(nullptr), cursor(nullptr), limit(nullptr), block_size(block_size), reserved(0)
+            {
+                for(int c = 0; c < num_classes; c++)
+                {
+                    free_lists[c] = nullptr;
+                }
+            }
+
+            ~arena()
+            {
+                release();
+            }
+
+            arena(const arena&) = delete;
+            arena& operator=(const arena&) = delete;
+
+            void* allocate(std::size_t bytes)
+            {
+                int c = sizeClass(bytes);
+                if(free_lists[c])
+                {
+                    free_chunk* chunk = free_lists[c];
+                    free_lists[c] = chunk->next;
+                    return chunk;
+                }
+
+                std::size_t chunk_size = min_chunk << c;
+                if(chunk_size > block_size / 4)
+                {
+                    //large chunks (table arrays of big books) get a block of their own
+                    return newBlock(chunk_size);
+                }
+                if(cursor == nullptr || static_cast<std::size_t>(limit - cursor) < chunk_size)
+                {
+                    cursor = newBlock(block_size);
+                    limit = cursor + block_size;
+                }
+                void* chunk = cursor;
+                cursor += chunk_size;
+                return chunk;
+            }
+
+            void deallocate(void* p, std::size_t bytes)
+            {
+                int c = sizeClass(bytes);
+                free_chunk* chunk = static_cast<free_chunk*>(p);
+                chunk->next = free_lists[c];
+                free_lists[c] = chunk;
+            }
+
+            //Bulk release of everything allocated from this arena. Containers using it must be destroyed
+            //(or simply abandoned) first.
+            void release()
+            {
+                while(blocks)
+                {
+                    block* next = blocks->next;
+                    ::operator delete(blocks);
+                    blocks = next;
+                }
+                cursor = nullptr;
+                limit = nullptr;
+                reserved = 0;
+                for(int c = 0; c < num_classes; c++)
+                {
+                    free_lists[c] = nullptr;
+                }
+            }
+
+            std::size_t reservedBytes() const
+            {
+                return reserved;
+            }
+    };
+
+    //Standard allocator over an arena. A null arena falls back to the global heap, so containers using
+    //this type behave like plain std containers unless a session arena is passed in.
+    template<typename T>
+    class arena_allocator
+    {
+        public:
+            typedef T value_type;
+            typedef std::true_type propagate_on_container_copy_assignment;
+            typedef std::true_type propagate_on_container_move_assignment;
+            typedef std::true_type propagate_on_container_swap;
+
+            arena* source;
+
+            arena_allocator()
+                : source(nullptr)
+            {
+
+            }
+
+            arena_allocator(arena* source)
+                : source(source)
+            {
+
+            }
+
+            template<typename U>
+            arena_allocator(const arena_allocator<U>& other)
+                : source(other.source)
+            {
+
+            }
+
+            T* allocate(std::size_t n)
+            {
+                static_assert(alignof(T) <= 16, "arena chunks are 16-byte aligned");
+                if(source)
+                {
+                    return static_cast<T*>(source->allocate(n * sizeof(T)));
+                }
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+
+            void deallocate(T* p, std::size_t n)
+            {
+                if(source)
+                {
+                    source->deallocate(p, n * sizeof(T));
+                    return;
+                }
+                ::operator delete(p);
+            }
+
+            template<typename U>
+            bool operator==(const arena_allocator<U>& other) const
+            {
+                return source == other.source;
+            }
+
+            template<typename U>
+            bool operator!=(const arena_allocator<U>& other) const
+            {
+                return source != other.source;
+            }
+    };
+}
+
+#endif
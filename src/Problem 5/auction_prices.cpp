@@ -2,121 +2,2409 @@
 > The underlying data structure is abseil's flat_hash_map. After running tests with various open-source hash maps, default STL containers and my own hashing functions, it was concluded that abseil's flat_hash_map performs the best with respect to insertions, and marginally worse in case of deletions. Overall, abseil's flat_hash_map is extremely fast and is one of the best candidates for an orderbook data structure.
 */
 #include "auction_prices.h"
+#include "journal.h"
+#include <algorithm>
+#include <stdexcept>
 
 //flat_hash_map AuctionPrices functions:
 
-int AP::AuctionPrices::addNewOrder(const char* item_ID, const char* auction_ID, int side, int price)
+AP::AuctionPrices::AuctionPrices()
+    : universe{nullptr, nullptr, nullptr, 0, 0, 0}, memory(nullptr), orders_hint(0), log(nullptr), fills(nullptr)
 {
-    return Library[(item_ID)].addNewOrder(auction_ID, side, price);
+
+}
+
+AP::AuctionPrices::AuctionPrices(AP::arena* memory)
+    : Library(memory), books(memory), universe{nullptr, nullptr, nullptr, 0, 0, 0}, memory(memory), orders_hint(0), log(nullptr), fills(nullptr)
+{
+
+}
+
+AP::AuctionPrices::AuctionPrices(uint32_t expected_items, uint32_t expected_orders_per_item, AP::arena* memory)
+    : Library(memory), books(memory), universe{nullptr, nullptr, nullptr, 0, 0, 0}, memory(memory), orders_hint(0), log(nullptr), fills(nullptr)
+{
+    reserve(expected_items, expected_orders_per_item);
+}
+
+AP::AuctionPrices::AuctionPrices(const AP::item_universe_view& items, AP::arena* memory)
+    : Library(memory), books(memory), universe(items), memory(memory), orders_hint(0), log(nullptr), fills(nullptr)
+{
+    if(!items.valid())
+    {
+        throw std::invalid_argument("item universe is empty or failed to build");
+    }
+    books.reserve(items.num_ids);
+    for(uint32_t i = 0; i < items.num_ids; i++)
+    {
+        books.emplace_back(memory);
+    }
+}
+
+int AP::AuctionPrices::configureItem(std::string_view item_ID, int tick_size, int min_price, int max_price)
+{
+    if(tick_size <= 0 || max_price < min_price || (log && !AP::journal::fits(item_ID)))
+    {
+        return 0;
+    }
+    if((static_cast<int64_t>(max_price) - min_price) / tick_size >= AP::orderbook::max_tick_levels)
+    {
+        //more prices than a level index can address
+        return 0;
+    }
+
+    uint32_t book_index;
+    AP::orderbook* book = bookFor(item_ID, book_index);
+    if(book == nullptr || !book->empty())
+    {
+        //the layout can only be chosen before the first order arrives
+        return 0;
+    }
+    //keep any capacity reserved for the item across the layout switch
+    uint32_t expected_orders = book->capacity();
+    *book = AP::orderbook(tick_size, min_price, max_price, memory);
+    book->reserve(expected_orders);
+    if(log)
+    {
+        log->recordConfigure(item_ID, tick_size, min_price, max_price);
+    }
+    return 1;
+}
+
+//Pre-sizing for a session whose volume is known before it opens (README improvement #3).
+//Books that already exist are grown now, books created later start at expected_orders_per_item.
+int AP::AuctionPrices::reserve(uint32_t expected_items, uint32_t expected_orders_per_item)
+{
+    if(!universe.num_ids)
+    {
+        Library.reserve(expected_items);
+        books.reserve(expected_items);
+    }
+    orders_hint = expected_orders_per_item;
+    if(universe.num_ids)
+    {
+        for(AP::orderbook& book: books)
+        {
+            book.reserve(orders_hint);
+        }
+        return 1;
+    }
+    //books of evicted items are left small
+    for(auto& item: Library)
+    {
+        books[item.second].reserve(orders_hint);
+    }
+    return 1;
+}
+
+int AP::AuctionPrices::reserveItem(std::string_view item_ID, uint32_t expected_orders)
+{
+    uint32_t book_index;
+    AP::orderbook* book = bookFor(item_ID, book_index);
+    if(book == nullptr)
+    {
+        return 0;
+    }
+    book->reserve(expected_orders);
+    return 1;
+}
+
+AP::orderbook* AP::AuctionPrices::bookFor(std::string_view item_ID, uint32_t& book)
+{
+    if(universe.num_ids)
+    {
+        //fixed universe: items outside it are rejected
+        book = universe.find(item_ID);
+        return (book == AP::no_item) ? nullptr : &books[book];
+    }
+
+    //look up by string_view first, so only a new item builds a std::string key
+    auto found = Library.find(item_ID);
+    if(found != Library.end())
+    {
+        book = found->second;
+        return &books[book];
+    }
+    if(!free_books.empty())
+    {
+        //the book of an evicted item: already empty, and its generations carry on
+        book = free_books.back();
+        free_books.pop_back();
+        Library.emplace(std::string(item_ID), book);
+        item_names[book] = std::string(item_ID);
+        books[book].reserve(orders_hint);
+        return &books[book];
+    }
+    book = static_cast<uint32_t>(books.size());
+    Library.emplace(std::string(item_ID), book);
+    item_names.emplace_back(item_ID);
+    books.emplace_back(memory);
+    books.back().reserve(orders_hint);
+    return &books[book];
+}
+
+AP::orderbook* AP::AuctionPrices::findBook(std::string_view item_ID)
+{
+    return const_cast<AP::orderbook*>(static_cast<const AP::AuctionPrices*>(this)->findBook(item_ID));
+}
+
+const AP::orderbook* AP::AuctionPrices::findBook(std::string_view item_ID) const
+{
+    if(universe.num_ids)
+    {
+        uint32_t book = universe.find(item_ID);
+        return (book == AP::no_item) ? nullptr : &books[book];
+    }
+
+    auto found = Library.find(item_ID);
+    return (found == Library.end()) ? nullptr : &books[found->second];
+}
+
+int AP::AuctionPrices::addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price)
+{
+    AP::order_handle handle;
+    return addNewOrder(item_ID, auction_ID, side, price, handle);
+}
+
+int AP::AuctionPrices::addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, AP::order_handle& handle)
+{
+    return addNewOrder(item_ID, auction_ID, side, price, 1, handle);
+}
+
+int AP::AuctionPrices::addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_add);
+    if(log && !(AP::journal::fits(item_ID) && AP::journal::fits(auction_ID)))
+    {
+        return 0;
+    }
+    uint32_t book;
+    AP::orderbook* orders = bookFor(item_ID, book);
+    if(orders == nullptr)
+    {
+        return 0;
+    }
+    AP_LATENCY_CLASS(orders->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    return placeOrder(orders, book, item_ID, auction_ID, side, price, quantity, handle);
+}
+
+int AP::AuctionPrices::placeOrder(AP::orderbook* orders, uint32_t book, std::string_view item_ID, std::string_view auction_ID,
+                                  int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    handle.book = book;
+    if(fills)
+    {
+        AP::fill_event fill;
+        uint32_t traded = 0;
+        while(quantity > 0 && orders->matchOnce(auction_ID, side, price, quantity, fill))
+        {
+            fill.item_ID = item_ID;
+            fill.resting.book = book;
+            traded += fill.quantity;
+            if(log)
+            {
+                //to the journal a trade is the resting order's delete or reduction, so replay does not match
+                if(fill.resting_left == 0)
+                {
+                    log->recordDelete(item_ID, fill.resting_ID.view());
+                }
+                else
+                {
+                    log->recordReduce(item_ID, fill.resting_ID.view(), fill.quantity);
+                }
+            }
+            fills->onFill(fill);
+        }
+        if(traded > 0 && quantity == 0)
+        {
+            //filled on arrival: nothing rests
+            handle.slot = 0;
+            handle.generation = 0;
+            return 1;
+        }
+    }
+    int add_status = orders->addNewOrder(auction_ID, side, price, quantity, handle);
+    if(log && add_status)
+    {
+        log->recordAdd(item_ID, auction_ID, side, price, quantity);
+    }
+    return add_status;
+}
+
+int AP::AuctionPrices::deleteOrder(std::string_view item_ID, std::string_view auction_ID)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_delete);
+    if(log && !(AP::journal::fits(item_ID) && AP::journal::fits(auction_ID)))
+    {
+        return 0;
+    }
+    //an unknown item has nothing to delete, and gets no book
+    AP::orderbook* orders = findBook(item_ID);
+    AP_LATENCY_CLASS(orders && orders->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    int delete_status = orders ? orders->deleteOrder(auction_ID) : 0;
+    if(log && delete_status)
+    {
+        log->recordDelete(item_ID, auction_ID);
+    }
+    return delete_status;
+}
+
+int AP::AuctionPrices::deleteOrder(const AP::order_handle& handle)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_delete);
+    //no item or auction_ID lookup: the handle addresses the book and the pool slot directly
+    if(handle.book >= books.size())
+    {
+        return 0;
+    }
+    AP::orderbook& book = books[handle.book];
+    AP_LATENCY_CLASS(book.tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    if(!log)
+    {
+        return book.deleteOrder(handle.slot, handle.generation);
+    }
+    //copied first: the delete may shrink the pool and free the slot's page
+    if(!book.holdsOrder(handle.slot, handle.generation))
+    {
+        return 0;
+    }
+    AP::order_id auction_ID(book.orderID(handle.slot));
+    book.deleteOrder(handle.slot, handle.generation);
+    log->recordDelete(itemName(handle.book), auction_ID.view());
+    return 1;
+}
+
+int AP::AuctionPrices::reduceOrder(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_reduce);
+    if(log && !(AP::journal::fits(item_ID) && AP::journal::fits(auction_ID)))
+    {
+        return 0;
+    }
+    AP::orderbook* orders = findBook(item_ID);
+    AP_LATENCY_CLASS(orders && orders->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    int reduce_status = orders ? orders->reduceOrder(auction_ID, quantity) : 0;
+    if(log && reduce_status)
+    {
+        log->recordReduce(item_ID, auction_ID, quantity);
+    }
+    return reduce_status;
+}
+
+int AP::AuctionPrices::amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity)
+{
+    AP::order_handle handle;
+    return amendOrder(item_ID, auction_ID, price, quantity, handle);
+}
+
+int AP::AuctionPrices::amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_amend);
+    if(log && !(AP::journal::fits(item_ID) && AP::journal::fits(auction_ID)))
+    {
+        return 0;
+    }
+    AP::orderbook* orders = findBook(item_ID);
+    AP_LATENCY_CLASS(orders && orders->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    //the side is only needed to see whether the amend crosses, so the extra lookup is left to matching mode
+    int side = 0;
+    int resting_price;
+    uint32_t resting = 0;
+    if(orders == nullptr || (fills && !orders->restingOrder(auction_ID, side, resting_price, resting))
+       || !orders->amendOrder(auction_ID, price, quantity, handle))
+    {
+        return 0;
+    }
+    handle.book = static_cast<uint32_t>(orders - books.data());
+    int best;
+    if(fills && (side == 1 ? (orders->bestOffer(best) && best <= price) : (orders->bestBid(best) && best >= price)))
+    {
+        //the amended order now crosses: it trades as a new order would, and its delete and re-add are journaled
+        //instead of the amend. Both stay inside this call's latency scope, so the amend is timed once.
+        orders->deleteOrder(auction_ID);
+        if(log)
+        {
+            log->recordDelete(item_ID, auction_ID);
+        }
+        return placeOrder(orders, handle.book, item_ID, auction_ID, side, price, quantity ? quantity : resting, handle);
+    }
+    if(log)
+    {
+        log->recordAmend(item_ID, auction_ID, price, quantity);
+    }
+    return 1;
+}
+
+//Batched adds/deletes for a feed that arrives in packets. Ops are grouped by item, keeping their order within
+//an item, so the outcome is the same as applying them one by one. Each book then hashes all of its auction_IDs
+//first and prefetches index slots ahead of the op being applied, so the cache misses of the lookups overlap.
+//Returns the number of ops that succeeded.
+int AP::AuctionPrices::applyBatch(AP::order_op* ops, size_t count)
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_batch);
+    AP_LATENCY_CLASS(AP::latency_mixed);
+    if(fills)
+    {
+        //matching mode: every add may trade, so the ops go through addNewOrder()/deleteOrder() one by one
+        int applied = 0;
+        for(size_t i = 0; i < count; i++)
+        {
+            AP::order_op& op = ops[i];
+            op.status = 0;
+            if(op.action == AP::order_action::add)
+            {
+                op.status = addNewOrder(op.item_ID, op.auction_ID, op.side, op.price, op.quantity, op.handle);
+            }
+            else if(op.action == AP::order_action::remove)
+            {
+                op.status = deleteOrder(op.item_ID, op.auction_ID);
+            }
+            else if(op.action == AP::order_action::reduce)
+            {
+                op.status = reduceOrder(op.item_ID, op.auction_ID, op.quantity);
+            }
+            else if(op.action == AP::order_action::amend)
+            {
+                op.status = amendOrder(op.item_ID, op.auction_ID, op.price, op.quantity, op.handle);
+            }
+            applied += op.status;
+        }
+        return applied;
+    }
+    batch_keys.resize(count);
+    batch_order.resize(count);
+    batch_hashes.resize(count);
+
+    if(!universe.num_ids)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            batch_hashes[i] = Library.hash_key(ops[i].item_ID);
+            Library.prefetch(batch_hashes[i]);
+        }
+    }
+
+    //every item is resolved before any order is applied: creating a book can move the books array
+    for(size_t i = 0; i < count; i++)
+    {
+        uint32_t book = AP::no_item;
+        //an order the attached journal cannot record is rejected, as in addNewOrder()
+        bool recordable = (log == nullptr || (AP::journal::fits(ops[i].item_ID) && AP::journal::fits(ops[i].auction_ID)));
+        if(recordable && universe.num_ids)
+        {
+            book = universe.find(ops[i].item_ID);
+        }
+        else if(recordable)
+        {
+            auto found = Library.find_hashed(ops[i].item_ID, batch_hashes[i]);
+            if(found != Library.end())
+            {
+                book = found->second;
+            }
+            else if(ops[i].action != AP::order_action::add || bookFor(ops[i].item_ID, book) == nullptr)
+            {
+                //only adds create books
+                book = AP::no_item;
+            }
+        }
+        ops[i].status = 0;
+        ops[i].handle.book = book;
+        //(book, position) keys sort into groups that keep the batch order, without a stable sort buffer
+        batch_keys[i] = (static_cast<uint64_t>(book) << 32) | i;
+    }
+    std::sort(batch_keys.begin(), batch_keys.end());
+    for(size_t i = 0; i < count; i++)
+    {
+        batch_order[i] = static_cast<uint32_t>(batch_keys[i]);
+    }
+
+    int applied = 0;
+    size_t first = 0;
+    while(first < count)
+    {
+        uint32_t book = static_cast<uint32_t>(batch_keys[first] >> 32);
+        size_t last = first + 1;
+        while(last < count && static_cast<uint32_t>(batch_keys[last] >> 32) == book)
+        {
+            last++;
+        }
+        if(book != AP::no_item)
+        {
+            applied += books[book].applyBatch(ops, &batch_order[first], &batch_hashes[first], static_cast<uint32_t>(last - first));
+        }
+        first = last;
+    }
+
+    if(log)
+    {
+        //journaled in batch order, which is an order the books could have seen them in
+        for(size_t i = 0; i < count; i++)
+        {
+            if(ops[i].status == 0)
+            {
+                continue;
+            }
+            if(ops[i].action == AP::order_action::add)
+            {
+                log->recordAdd(ops[i].item_ID, ops[i].auction_ID, ops[i].side, ops[i].price, ops[i].quantity);
+            }
+            else if(ops[i].action == AP::order_action::remove)
+            {
+                log->recordDelete(ops[i].item_ID, ops[i].auction_ID);
+            }
+            else if(ops[i].action == AP::order_action::reduce)
+            {
+                log->recordReduce(ops[i].item_ID, ops[i].auction_ID, ops[i].quantity);
+            }
+            else if(ops[i].action == AP::order_action::amend)
+            {
+                log->recordAmend(ops[i].item_ID, ops[i].auction_ID, ops[i].price, ops[i].quantity);
+            }
+        }
+    }
+    return applied;
+}
+
+uint32_t AP::AuctionPrices::compact()
+{
+    for(AP::orderbook& book: books)
+    {
+        book.shrink();
+    }
+    if(universe.num_ids)
+    {
+        return 0;
+    }
+
+    uint32_t evicted = 0;
+    for(auto item = Library.begin(); item != Library.end();)
+    {
+        AP::orderbook& book = books[item->second];
+        if(!book.empty() || book.tickIndexed())
+        {
+            ++item;
+            continue;
+        }
+        free_books.push_back(item->second);
+        std::string().swap(item_names[item->second]);
+        item = Library.erase(item);
+        evicted++;
+    }
+    if(evicted)
+    {
+        Library.shrink_to_fit();
+    }
+    return evicted;
+}
+
+const AP::latency_stats* AP::AuctionPrices::latencyStats() const
+{
+#if defined(AP_ENABLE_LATENCY_STATS)
+    return &latency;
+#else
+    return nullptr;
+#endif
+}
+
+void AP::AuctionPrices::attachJournal(AP::journal* log)
+{
+    this->log = log;
+}
+
+void AP::AuctionPrices::attachFillListener(AP::fill_listener* fills)
+{
+    this->fills = fills;
+}
+
+std::string_view AP::AuctionPrices::itemName(uint32_t book) const
+{
+    return universe.num_ids ? universe.ids[book] : std::string_view(item_names[book]);
+}
+
+int AP::AuctionPrices::bestBid(std::string_view item_ID, int& price) const
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_top);
+    const AP::orderbook* book = findBook(item_ID);
+    AP_LATENCY_CLASS(book && book->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    return book ? book->bestBid(price) : 0;
+}
+
+int AP::AuctionPrices::bestOffer(std::string_view item_ID, int& price) const
+{
+    AP_LATENCY_SCOPE(latency, AP::latency_top);
+    const AP::orderbook* book = findBook(item_ID);
+    AP_LATENCY_CLASS(book && book->tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+    return book ? book->bestOffer(price) : 0;
+}
+
+int AP::AuctionPrices::clearingPrice(std::string_view item_ID, AP::auction_clearing& result) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->clearingPrice(result) : 0;
+}
+
+uint64_t AP::AuctionPrices::depthAtOrBetter(std::string_view item_ID, int side, int price) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->depthAtOrBetter(side, price) : 0;
+}
+
+int AP::AuctionPrices::priceToFill(std::string_view item_ID, int side, uint64_t quantity, int& price) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->priceToFill(side, quantity, price) : 0;
+}
+
+uint32_t AP::AuctionPrices::topN(std::string_view item_ID, int side, AP::depth_level* levels, uint32_t n) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->topN(side, levels, n) : 0;
+}
+
+uint32_t AP::AuctionPrices::topN(std::string_view item_ID, int side, AP::depth_order* orders, uint32_t n) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->topN(side, orders, n) : 0;
+}
+
+int AP::AuctionPrices::print()
+{
+    AP::output_sink out;
+    return print(out) && out.flush();
+}
+
+int AP::AuctionPrices::print(AP::output_sink& out)
+{
+    int print_status = 1;
+    for(uint32_t i = 0; i < universe.num_ids; i++)
+    {
+        AP_LATENCY_SCOPE(latency, AP::latency_print);
+        AP_LATENCY_CLASS(books[i].tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+        out.put(universe.ids[i]).put(":\n");
+        print_status = books[i].print(out);
+        if(print_status == 0)
+        {
+            return 0;
+        }
+    }
+    for(auto& i: Library)
+    {
+        AP_LATENCY_SCOPE(latency, AP::latency_print);
+        AP_LATENCY_CLASS(books[i.second].tickIndexed() ? AP::latency_tick : AP::latency_hashed);
+        out.put(i.first).put(":\n");
+        print_status = books[i.second].print(out);
+        if(print_status == 0)
+        {
+            return 0;
+        }
+        //std::cout<<"\n";
+    }
+    return 1;
+}
+
+
+AP::orderbook::orderbook()
+    : next_generation(1), live_orders(0), stale_refs(0), peak_orders(0),
+      tick_size(0), min_price(0), num_levels(0), best_bid_level(UINT32_MAX), best_offer_level(UINT32_MAX),
+      small_orders(), small_layout(true)
+{
+
+}
+
+AP::orderbook::orderbook(AP::arena* memory)
+    : index(memory), bid_depth(memory), offer_depth(memory), free_slots(memory),
+      next_generation(1), live_orders(0), stale_refs(0), peak_orders(0),
+      tick_size(0), min_price(0), num_levels(0),
+      bid_levels(memory), offer_levels(memory), bid_occupied(memory), offer_occupied(memory),
+      bid_volume(memory), offer_volume(memory),
+      best_bid_level(UINT32_MAX), best_offer_level(UINT32_MAX), small_orders(), small_layout(true)
+{
+
+}
+
+AP::orderbook::orderbook(int tick_size, int min_price, int max_price, AP::arena* memory)
+    : index(memory), bid_depth(memory), offer_depth(memory), free_slots(memory),
+      next_generation(1), live_orders(0), stale_refs(0), peak_orders(0),
+      tick_size(0), min_price(min_price), num_levels(0),
+      bid_levels(memory), offer_levels(memory), bid_occupied(memory), offer_occupied(memory),
+      bid_volume(memory), offer_volume(memory),
+      best_bid_level(UINT32_MAX), best_offer_level(UINT32_MAX), small_orders(), small_layout(true)
+{
+    if(tick_size <= 0 || max_price < min_price || (static_cast<int64_t>(max_price) - min_price) / tick_size >= max_tick_levels)
+    {
+        //invalid range, keep the hashed layout
+        return;
+    }
+
+    small_layout = false;
+    this->tick_size = tick_size;
+    num_levels = static_cast<uint32_t>((static_cast<int64_t>(max_price) - min_price) / tick_size + 1);
+
+    const price_level empty_level = {UINT32_MAX, UINT32_MAX, 0, 0};
+    bid_levels.assign(num_levels, empty_level);
+    offer_levels.assign(num_levels, empty_level);
+    bid_occupied.assign((num_levels + 63) / 64, 0);
+    offer_occupied.assign((num_levels + 63) / 64, 0);
+    bid_volume.assign(num_levels);
+    offer_volume.assign(num_levels);
+}
+
+void AP::orderbook::reserve(uint32_t expected_orders)
+{
+    if(small_layout)
+    {
+        if(expected_orders <= small_book_orders)
+        {
+            return;
+        }
+        promoteSmall();
+    }
+    index.reserve(expected_orders);
+    orders.reserve(expected_orders);
+    free_slots.reserve(expected_orders);
+}
+
+uint32_t AP::orderbook::capacity() const
+{
+    return static_cast<uint32_t>(orders.capacity());
+}
+
+void AP::orderbook::shrink()
+{
+    if(small_layout)
+    {
+        return;
+    }
+    if(live_orders == 0 && !tick_size)
+    {
+        //generations carry on, so handles to the old orders stay stale
+        uint32_t generation = next_generation;
+        *this = AP::orderbook(free_slots.get_allocator().source);
+        next_generation = generation;
+        return;
+    }
+
+    if(stale_refs)
+    {
+        sweepStaleRefs();
+    }
+    uint32_t used = orders.size();
+    while(used > 0 && orders[used - 1].generation == 0)
+    {
+        used--;
+    }
+    orders.truncate(used);
+    free_slots.erase(std::remove_if(free_slots.begin(), free_slots.end(), [used](uint32_t slot){ return slot >= used; }), free_slots.end());
+    //lowest slots are reused first, so the last pages can empty out before the next shrink
+    std::sort(free_slots.begin(), free_slots.end(), std::greater<uint32_t>());
+    free_slots.shrink_to_fit();
+    index.shrink_to_fit();
+    peak_orders = live_orders;
+}
+
+//The pass is linear in the book, and runs once the book has lost 7/8 of the orders it grew to
+void AP::orderbook::shrinkIfDrained()
+{
+    if(peak_orders >= AP::cow_pool<order_node>::page_size && live_orders < peak_orders / 8)
+    {
+        shrink();
+    }
+}
+
+bool AP::orderbook::empty() const
+{
+    return live_orders == 0;
+}
+
+bool AP::orderbook::tickIndexed() const
+{
+    return tick_size != 0;
+}
+
+// order pool functions:
+
+//Generations grow with arrival order (0 is never handed out), which is how snapshots order the orders at a price
+uint32_t AP::orderbook::takeGeneration()
+{
+    uint32_t generation = next_generation;
+    if(++next_generation == 0)
+    {
+        next_generation = 1;
+    }
+    return generation;
+}
+
+uint32_t AP::orderbook::acquireSlot(std::string_view auction_ID, int side, int price, uint32_t quantity)
+{
+    uint32_t slot;
+    if(free_slots.empty())
+    {
+        slot = static_cast<uint32_t>(orders.size());
+        orders.push_back(order_node());
+    }
+    else
+    {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    order_node& node = orders.write(slot);
+    node.auction_ID = AP::order_id(auction_ID);
+    node.side = static_cast<uint8_t>(side);
+    node.price = price;
+    node.quantity = quantity;
+    node.generation = takeGeneration();
+    live_orders++;
+    if(live_orders > peak_orders)
+    {
+        peak_orders = live_orders;
+    }
+    return slot;
+}
+
+void AP::orderbook::removeOrder(uint32_t slot)
+{
+    if(tick_size)
+    {
+        unlinkLevelOrder(slot);
+    }
+    else
+    {
+        unlinkDepthOrder(slot);
+    }
+
+    orders.write(slot).generation = 0;
+    free_slots.push_back(slot);
+    live_orders--;
+}
+
+//Queues the order in slot at its price in the hashed layout's depth maps
+void AP::orderbook::linkDepthOrder(uint32_t slot)
+{
+    const order_node& node = orders[slot];
+    if(node.side == 1)
+    {
+        pushQueue(bid_depth[node.price], slot);
+    }
+    else
+    {
+        pushQueue(offer_depth[node.price], slot);
+    }
+}
+
+void AP::orderbook::unlinkDepthOrder(uint32_t slot)
+{
+    const order_node& node = orders[slot];
+    if(node.side == 1)
+    {
+        auto depth = bid_depth.find(node.price);
+        unlinkQueue(depth->second, slot);
+        if(depth->second.count == 0)
+        {
+            bid_depth.erase(depth);
+        }
+    }
+    else
+    {
+        auto depth = offer_depth.find(node.price);
+        unlinkQueue(depth->second, slot);
+        if(depth->second.count == 0)
+        {
+            offer_depth.erase(depth);
+        }
+    }
+}
+
+//Appends slot to queue: it is the newest order at its price
+void AP::orderbook::pushQueue(price_level& queue, uint32_t slot)
+{
+    order_node& node = orders.write(slot);
+    node.prev = queue.count ? queue.tail : UINT32_MAX;
+    node.next = UINT32_MAX;
+    if(queue.count == 0)
+    {
+        queue.head = slot;
+    }
+    else
+    {
+        orders.write(queue.tail).next = slot;
+    }
+    queue.tail = slot;
+    queue.count++;
+    queue.quantity += node.quantity;
+}
+
+void AP::orderbook::unlinkQueue(price_level& queue, uint32_t slot)
+{
+    uint32_t prev = orders[slot].prev;
+    uint32_t next = orders[slot].next;
+    if(prev != UINT32_MAX)
+    {
+        orders.write(prev).next = next;
+    }
+    else
+    {
+        queue.head = next;
+    }
+    if(next != UINT32_MAX)
+    {
+        orders.write(next).prev = prev;
+    }
+    else
+    {
+        queue.tail = prev;
+    }
+    queue.count--;
+    queue.quantity -= orders[slot].quantity;
+}
+
+bool AP::orderbook::isLive(const order_ref& ref) const
+{
+    return orders[ref.slot].generation == ref.generation;
+}
+
+void AP::orderbook::sweepStaleRefs()
+{
+    for(auto it = index.begin(); it != index.end();)
+    {
+        if(isLive(it->second))
+        {
+            ++it;
+        }
+        else
+        {
+            it = index.erase(it);
+        }
+    }
+    stale_refs = 0;
+}
+
+// flat_hash_map orderbook functions:
+
+int AP::orderbook::addNewOrder(std::string_view auction_ID, int side, int price)
+{
+    AP::order_handle handle;
+    return addNewOrder(auction_ID, side, price, handle);
+}
+
+int inline AP::orderbook::addNewOrder(std::string_view auction_ID, int side, int price, AP::order_handle& handle)
+{
+    return addHashedOrder(auction_ID, index.hash_key(auction_ID), side, price, 1, handle);
+}
+
+int AP::orderbook::addNewOrder(std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    return addHashedOrder(auction_ID, index.hash_key(auction_ID), side, price, quantity, handle);
+}
+
+//hash is index.hash_key(auction_ID), computed by the caller so a batch can hash and prefetch ahead
+int AP::orderbook::addHashedOrder(std::string_view auction_ID, size_t hash, int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    if(quantity == 0)
+    {
+        return 0;
+    }
+    if(tick_size)
+    {
+        return addLevelOrder(auction_ID, hash, side, price, quantity, handle);
+    }
+
+    if(side != 1 && side != 2)
+    {
+        return 0;
+    }
+    if(small_layout)
+    {
+        int small_status = addSmallOrder(auction_ID, side, price, quantity, handle);
+        if(small_status >= 0)
+        {
+            return small_status;
+        }
+        //every inline entry is taken: from here on the book is hashed
+        promoteSmall();
+    }
+
+    uint32_t slot = free_slots.empty() ? static_cast<uint32_t>(orders.size()) : free_slots.back();
+    order_ref ref = {slot, next_generation};
+
+    auto inserted = index.emplace_hashed(hash, auction_ID, ref);
+    if(!inserted.second)
+    {
+        if(isLive(inserted.first->second))
+        {
+            //existing order is kept, whichever side it rests on
+            handle.slot = inserted.first->second.slot;
+            handle.generation = inserted.first->second.generation;
+            return 1;
+        }
+        inserted.first->second = ref;
+        stale_refs--;
+    }
+
+    acquireSlot(auction_ID, side, price, quantity);
+    linkDepthOrder(slot);
+
+    handle.slot = ref.slot;
+    handle.generation = ref.generation;
+    return 1;
+}
+
+int inline AP::orderbook::deleteOrder(std::string_view auction_ID)
+{
+    return deleteHashedOrder(auction_ID, index.hash_key(auction_ID));
+}
+
+int AP::orderbook::deleteHashedOrder(std::string_view auction_ID, size_t hash)
+{
+    if(empty())
+    {
+        //some message
+        return 0;
+    }
+    if(small_layout)
+    {
+        return deleteSmallOrder(auction_ID);
+    }
+    
+    auto found = index.find_hashed(auction_ID, hash);
+    if(found==index.end())
+    {
+        return 0;
+    }
+    order_ref ref = found->second;
+    index.erase(found);
+    if(!isLive(ref))
+    {
+        //already deleted through its handle
+        stale_refs--;
+        return 0;
+    }
+    removeOrder(ref.slot);
+    shrinkIfDrained();
+    return 1;
+}
+
+int AP::orderbook::holdsOrder(uint32_t slot, uint32_t generation) const
+{
+    if(generation == 0)
+    {
+        return 0;
+    }
+    if(small_layout)
+    {
+        return slot < small_book_orders && small_orders[slot].generation == generation;
+    }
+    return slot < orders.size() && orders[slot].generation == generation;
+}
+
+int AP::orderbook::deleteOrder(uint32_t slot, uint32_t generation)
+{
+    if(!holdsOrder(slot, generation))
+    {
+        return 0;
+    }
+    if(small_layout)
+    {
+        removeSmallOrder(slot);
+        return 1;
+    }
+    removeOrder(slot);
+
+    //the auction_ID entry is left behind; reclaim stale entries once they outnumber live orders
+    if(++stale_refs > 64 && stale_refs > live_orders)
+    {
+        sweepStaleRefs();
+    }
+    shrinkIfDrained();
+    return 1;
+}
+
+int AP::orderbook::reduceOrder(std::string_view auction_ID, uint32_t quantity)
+{
+    return reduceHashedOrder(auction_ID, index.hash_key(auction_ID), quantity);
+}
+
+int AP::orderbook::reduceHashedOrder(std::string_view auction_ID, size_t hash, uint32_t quantity)
+{
+    if(quantity == 0 || empty())
+    {
+        return 0;
+    }
+    uint32_t slot = UINT32_MAX;
+    uint32_t resting = 0;
+    if(small_layout)
+    {
+        for(uint32_t r = 0; r < live_orders && slot == UINT32_MAX; r++)
+        {
+            if(small_orders[small_rank[r]].auction_ID.view() == auction_ID)
+            {
+                slot = small_rank[r];
+                resting = small_orders[slot].quantity;
+            }
+        }
+    }
+    else
+    {
+        auto found = index.find_hashed(auction_ID, hash);
+        if(found != index.end() && isLive(found->second))
+        {
+            slot = found->second.slot;
+            resting = orders[slot].quantity;
+        }
+    }
+    if(slot == UINT32_MAX)
+    {
+        return 0;
+    }
+    if(quantity >= resting)
+    {
+        return deleteHashedOrder(auction_ID, hash);
+    }
+    reduceSlot(slot, quantity);
+    return 1;
+}
+
+//Takes quantity (less than all of it) off the order in slot, in place
+void AP::orderbook::reduceSlot(uint32_t slot, uint32_t quantity)
+{
+    if(small_layout)
+    {
+        small_orders[slot].quantity -= quantity;
+        return;
+    }
+    order_node& node = orders.write(slot);
+    node.quantity -= quantity;
+    if(tick_size)
+    {
+        (node.side == 1 ? bid_levels : offer_levels)[node.level].quantity -= quantity;
+        (node.side == 1 ? bid_volume : offer_volume).add(node.level, -static_cast<int64_t>(quantity));
+    }
+    else if(node.side == 1)
+    {
+        bid_depth.find(node.price)->second.quantity -= quantity;
+    }
+    else
+    {
+        offer_depth.find(node.price)->second.quantity -= quantity;
+    }
+}
+
+int AP::orderbook::amendOrder(std::string_view auction_ID, int price, uint32_t quantity)
+{
+    AP::order_handle handle;
+    return amendHashedOrder(auction_ID, index.hash_key(auction_ID), price, quantity, handle);
+}
+
+int AP::orderbook::amendOrder(std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    return amendHashedOrder(auction_ID, index.hash_key(auction_ID), price, quantity, handle);
+}
+
+int AP::orderbook::amendHashedOrder(std::string_view auction_ID, size_t hash, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    if(empty())
+    {
+        return 0;
+    }
+    if(small_layout)
+    {
+        return amendSmallOrder(auction_ID, price, quantity, handle);
+    }
+    uint32_t level = 0;
+    if(tick_size && !levelOf(price, level))
+    {
+        return 0;
+    }
+    auto found = index.find_hashed(auction_ID, hash);
+    if(found == index.end() || !isLive(found->second))
+    {
+        return 0;
+    }
+    uint32_t slot = found->second.slot;
+    uint32_t resting = orders[slot].quantity;
+    quantity = quantity ? quantity : resting;
+    handle.slot = slot;
+    if(price == orders[slot].price && quantity <= resting)
+    {
+        //a cut in size keeps the order's place in the queue
+        if(quantity < resting)
+        {
+            reduceSlot(slot, resting - quantity);
+        }
+        handle.generation = found->second.generation;
+        return 1;
+    }
+
+    //a new price or a larger size queues the order again, behind the orders already at its price
+    if(tick_size)
+    {
+        unlinkLevelOrder(slot);
+    }
+    else
+    {
+        unlinkDepthOrder(slot);
+    }
+    order_node& node = orders.write(slot);
+    node.price = price;
+    node.quantity = quantity;
+    node.level = static_cast<uint16_t>(level);
+    node.generation = takeGeneration();
+    found->second.generation = node.generation;
+    handle.generation = node.generation;
+    if(tick_size)
+    {
+        linkLevelOrder(slot);
+    }
+    else
+    {
+        linkDepthOrder(slot);
+    }
+    return 1;
+}
+
+int AP::orderbook::restingOrder(std::string_view auction_ID, int& side, int& price, uint32_t& quantity) const
+{
+    if(small_layout)
+    {
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.auction_ID.view() == auction_ID)
+            {
+                side = entry.side;
+                price = entry.price;
+                quantity = entry.quantity;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    auto found = index.find(auction_ID);
+    if(found == index.end() || !isLive(found->second))
+    {
+        return 0;
+    }
+    const order_node& node = orders[found->second.slot];
+    side = node.side;
+    price = node.price;
+    quantity = node.quantity;
+    return 1;
+}
+
+// matching functions:
+
+bool AP::orderbook::isResting(std::string_view auction_ID, size_t hash) const
+{
+    if(small_layout)
+    {
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            if(small_orders[small_rank[r]].auction_ID.view() == auction_ID)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    auto found = index.find_hashed(auction_ID, hash);
+    return found != index.end() && isLive(found->second);
+}
+
+//Slot (and generation) of the order on side that trades first: best price, then earliest arrival. UINT32_MAX if none.
+uint32_t AP::orderbook::oldestOrder(int side, uint32_t& generation) const
+{
+    uint32_t slot = UINT32_MAX;
+    if(small_layout)
+    {
+        const small_order* best = firstSmallOrder(side);
+        if(best)
+        {
+            slot = static_cast<uint32_t>(best - small_orders);
+            generation = best->generation;
+        }
+        return slot;
+    }
+    if(tick_size)
+    {
+        uint32_t level = (side == 1) ? best_bid_level : best_offer_level;
+        if(level != UINT32_MAX)
+        {
+            slot = (side == 1) ? bid_levels[level].head : offer_levels[level].head;
+        }
+    }
+    else if(side == 1 && !bid_depth.empty())
+    {
+        slot = bid_depth.begin()->second.head;
+    }
+    else if(side == 2 && !offer_depth.empty())
+    {
+        slot = offer_depth.begin()->second.head;
+    }
+    if(slot != UINT32_MAX)
+    {
+        generation = orders[slot].generation;
+    }
+    return slot;
+}
+
+int AP::orderbook::matchOnce(std::string_view auction_ID, int side, int price, uint32_t& quantity, AP::fill_event& fill)
+{
+    size_t hash = index.hash_key(auction_ID);
+    uint32_t level;
+    if(quantity == 0 || (side != 1 && side != 2) || (tick_size && !levelOf(price, level))
+       || isResting(auction_ID, hash))
+    {
+        return 0;
+    }
+    int best;
+    bool crosses = (side == 1) ? (bestOffer(best) && best <= price) : (bestBid(best) && best >= price);
+    if(!crosses)
+    {
+        return 0;
+    }
+
+    uint32_t generation = 0;
+    uint32_t slot = oldestOrder(side == 1 ? 2 : 1, generation);
+    uint32_t resting = small_layout ? small_orders[slot].quantity : orders[slot].quantity;
+    uint32_t traded = std::min(quantity, resting);
+    //copied before a delete, which may shrink the pool
+    fill.incoming_ID = auction_ID;
+    fill.resting_ID = AP::order_id(orderID(slot));
+    fill.resting.slot = slot;
+    fill.resting.generation = generation;
+    fill.side = side;
+    fill.price = best;
+    fill.quantity = traded;
+    fill.resting_left = resting - traded;
+    if(traded == resting)
+    {
+        deleteOrder(slot, generation);
+    }
+    else
+    {
+        reduceSlot(slot, traded);
+    }
+    quantity -= traded;
+    return 1;
+}
+
+// call auction functions:
+
+//Calls visit(price, bids, offers) with the bid and offer quantity of every price between the best offer and the best bid
+//(the prices where the book crosses), lowest first. Nothing is visited if the book does not cross.
+template<typename Visitor>
+void AP::orderbook::forEachCrossingLevel(Visitor&& visit) const
+{
+    int best_bid;
+    int best_offer;
+    if(!bestBid(best_bid) || !bestOffer(best_offer) || best_bid < best_offer)
+    {
+        return;
+    }
+
+    if(tick_size)
+    {
+        for(uint32_t l = best_offer_level; l <= best_bid_level; l++)
+        {
+            if(bid_levels[l].count || offer_levels[l].count)
+            {
+                visit(min_price + static_cast<int>(l) * tick_size, bid_levels[l].quantity, offer_levels[l].quantity);
+            }
+        }
+        return;
+    }
+
+    if(small_layout)
+    {
+        //a handful of prices, put in order by insertion
+        int prices[small_book_orders];
+        uint64_t bids[small_book_orders];
+        uint64_t offers[small_book_orders];
+        uint32_t num_prices = 0;
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.price < best_offer || entry.price > best_bid)
+            {
+                continue;
+            }
+            uint32_t i = 0;
+            while(i < num_prices && prices[i] < entry.price)
+            {
+                i++;
+            }
+            if(i == num_prices || prices[i] != entry.price)
+            {
+                for(uint32_t j = num_prices; j > i; j--)
+                {
+                    prices[j] = prices[j - 1];
+                    bids[j] = bids[j - 1];
+                    offers[j] = offers[j - 1];
+                }
+                prices[i] = entry.price;
+                bids[i] = 0;
+                offers[i] = 0;
+                num_prices++;
+            }
+            (entry.side == 1 ? bids : offers)[i] += entry.quantity;
+        }
+        for(uint32_t i = 0; i < num_prices; i++)
+        {
+            visit(prices[i], bids[i], offers[i]);
+        }
+        return;
+    }
+
+    //bid_depth runs from the best bid down, so the bids at or above the best offer are walked backwards
+    auto bid = std::make_reverse_iterator(bid_depth.upper_bound(best_offer));
+    auto offer = offer_depth.begin();
+    while(true)
+    {
+        bool bids_left = (bid != bid_depth.rend());
+        bool offers_left = (offer != offer_depth.end() && offer->first <= best_bid);
+        if(!bids_left && !offers_left)
+        {
+            break;
+        }
+        if(offers_left && (!bids_left || offer->first < bid->first))
+        {
+            visit(offer->first, uint64_t(0), offer->second.quantity);
+            ++offer;
+        }
+        else if(!offers_left || bid->first < offer->first)
+        {
+            visit(bid->first, bid->second.quantity, uint64_t(0));
+            ++bid;
+        }
+        else
+        {
+            visit(bid->first, bid->second.quantity, offer->second.quantity);
+            ++bid;
+            ++offer;
+        }
+    }
+}
+
+//Bids at or above price and offers at or below it; price must lie where the book crosses
+void AP::orderbook::depthAt(int price, uint64_t& bids, uint64_t& offers) const
+{
+    bids = 0;
+    offers = 0;
+    forEachCrossingLevel([&](int level_price, uint64_t level_bids, uint64_t level_offers)
+    {
+        bids += (level_price >= price) ? level_bids : 0;
+        offers += (level_price <= price) ? level_offers : 0;
+    });
+}
+
+int AP::orderbook::clearingPrice(AP::auction_clearing& result) const
+{
+    //all the bid quantity in the crossing range buys at the lowest crossing price
+    uint64_t demand = 0;
+    forEachCrossingLevel([&demand](int, uint64_t bids, uint64_t)
+    {
+        demand += bids;
+    });
+    if(demand == 0)
+    {
+        return 0;
+    }
+
+    //Demand only falls and supply only grows with the price, so the prices tied on volume and imbalance are
+    //consecutive: the run is kept as its first and last price.
+    uint64_t supply = 0;
+    uint64_t best_volume = 0;
+    uint64_t best_gap = 0;
+    int first = 0;
+    int last = 0;
+    int64_t first_imbalance = 0;
+    int64_t last_imbalance = 0;
+    forEachCrossingLevel([&](int price, uint64_t bids, uint64_t offers)
+    {
+        supply += offers;
+        uint64_t volume = std::min(demand, supply);
+        int64_t imbalance = static_cast<int64_t>(demand) - static_cast<int64_t>(supply);
+        uint64_t gap = static_cast<uint64_t>(imbalance < 0 ? -imbalance : imbalance);
+        if(volume > best_volume || (volume == best_volume && gap < best_gap))
+        {
+            best_volume = volume;
+            best_gap = gap;
+            first = last = price;
+            first_imbalance = last_imbalance = imbalance;
+        }
+        else if(volume == best_volume && gap == best_gap)
+        {
+            last = price;
+            last_imbalance = imbalance;
+        }
+        //bids at this price do not buy above it
+        demand -= bids;
+    });
+
+    int price;
+    if(last_imbalance > 0)
+    {
+        price = last;
+    }
+    else if(first_imbalance < 0)
+    {
+        price = first;
+    }
+    else
+    {
+        //any price between the ends of the run executes the same volume with no larger imbalance
+        price = static_cast<int>(first + (static_cast<int64_t>(last) - first) / 2);
+        if(tick_size)
+        {
+            price = min_price + static_cast<int>((static_cast<int64_t>(price) - min_price) / tick_size) * tick_size;
+        }
+    }
+
+    uint64_t bids;
+    uint64_t offers;
+    depthAt(price, bids, offers);
+    result.price = price;
+    result.volume = std::min(bids, offers);
+    result.imbalance = static_cast<int64_t>(bids) - static_cast<int64_t>(offers);
+    return 1;
+}
+
+uint64_t AP::orderbook::depthAtOrBetter(int side, int price) const
+{
+    if(side != 1 && side != 2)
+    {
+        return 0;
+    }
+    if(tick_size)
+    {
+        const AP::fenwick_tree& volume = (side == 1) ? bid_volume : offer_volume;
+        uint64_t total = volume.prefix(num_levels - 1);
+        int64_t offset = static_cast<int64_t>(price) - min_price;
+        if(side == 1)
+        {
+            //bids on the levels from the first one at or above price
+            if(offset <= 0)
+            {
+                return total;
+            }
+            int64_t first = (offset + tick_size - 1) / tick_size;
+            return (first >= static_cast<int64_t>(num_levels)) ? 0 : total - volume.prefix(static_cast<uint32_t>(first - 1));
+        }
+        //offers on the levels up to the last one at or below price
+        if(offset < 0)
+        {
+            return 0;
+        }
+        int64_t last = offset / tick_size;
+        return (last >= static_cast<int64_t>(num_levels)) ? total : volume.prefix(static_cast<uint32_t>(last));
+    }
+
+    uint64_t depth = 0;
+    if(small_layout)
+    {
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.side == side && (side == 1 ? entry.price >= price : entry.price <= price))
+            {
+                depth += entry.quantity;
+            }
+        }
+    }
+    else if(side == 1)
+    {
+        for(auto level = bid_depth.begin(); level != bid_depth.end() && level->first >= price; ++level)
+        {
+            depth += level->second.quantity;
+        }
+    }
+    else
+    {
+        for(auto level = offer_depth.begin(); level != offer_depth.end() && level->first <= price; ++level)
+        {
+            depth += level->second.quantity;
+        }
+    }
+    return depth;
+}
+
+int AP::orderbook::priceToFill(int side, uint64_t quantity, int& price) const
+{
+    if((side != 1 && side != 2) || quantity == 0)
+    {
+        return 0;
+    }
+    if(tick_size)
+    {
+        const AP::fenwick_tree& volume = (side == 1) ? bid_volume : offer_volume;
+        uint32_t level;
+        if(side == 2)
+        {
+            //offers fill from the lowest level up
+            level = volume.firstReaching(quantity);
+        }
+        else
+        {
+            //bids fill from the highest level down: the answer is the highest level whose suffix sum reaches
+            //quantity, which is the first one where the prefix sum passes what the other levels hold
+            uint64_t total = volume.prefix(num_levels - 1);
+            level = (total < quantity) ? num_levels : volume.firstReaching(total - quantity + 1);
+        }
+        if(level >= num_levels)
+        {
+            return 0;
+        }
+        price = min_price + static_cast<int>(level) * tick_size;
+        return 1;
+    }
+
+    uint64_t taken = 0;
+    if(small_layout)
+    {
+        //small_rank lists each side best price first
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.side == side && (taken += entry.quantity) >= quantity)
+            {
+                price = entry.price;
+                return 1;
+            }
+        }
+    }
+    else if(side == 1)
+    {
+        for(auto level = bid_depth.begin(); level != bid_depth.end(); ++level)
+        {
+            if((taken += level->second.quantity) >= quantity)
+            {
+                price = level->first;
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        for(auto level = offer_depth.begin(); level != offer_depth.end(); ++level)
+        {
+            if((taken += level->second.quantity) >= quantity)
+            {
+                price = level->first;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+std::string_view AP::orderbook::orderID(uint32_t slot) const
+{
+    return small_layout ? small_orders[slot].auction_ID.view() : orders[slot].auction_ID.view();
+}
+
+int AP::orderbook::applyBatch(AP::order_op* ops, const uint32_t* order, size_t* hashes, uint32_t count)
+{
+    //how many ops ahead of the one being applied its index slot is prefetched
+    const uint32_t prefetch_distance = 8;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        hashes[i] = index.hash_key(ops[order[i]].auction_ID);
+    }
+    for(uint32_t i = 0; i < count && i < prefetch_distance; i++)
+    {
+        index.prefetch(hashes[i]);
+    }
+
+    int applied = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(i + prefetch_distance < count)
+        {
+            index.prefetch(hashes[i + prefetch_distance]);
+        }
+        AP::order_op& op = ops[order[i]];
+        if(op.action == AP::order_action::add)
+        {
+            op.status = addHashedOrder(op.auction_ID, hashes[i], op.side, op.price, op.quantity, op.handle);
+        }
+        else if(op.action == AP::order_action::remove)
+        {
+            op.status = deleteHashedOrder(op.auction_ID, hashes[i]);
+        }
+        else if(op.action == AP::order_action::reduce)
+        {
+            op.status = reduceHashedOrder(op.auction_ID, hashes[i], op.quantity);
+        }
+        else if(op.action == AP::order_action::amend)
+        {
+            op.status = amendHashedOrder(op.auction_ID, hashes[i], op.price, op.quantity, op.handle);
+        }
+        applied += op.status;
+    }
+    return applied;
+}
+
+int AP::orderbook::bestBid(int& price) const
+{
+    if(tick_size)
+    {
+        if(best_bid_level == UINT32_MAX)
+        {
+            return 0;
+        }
+        price = min_price + static_cast<int>(best_bid_level) * tick_size;
+        return 1;
+    }
+
+    if(small_layout)
+    {
+        const small_order* best = firstSmallOrder(1);
+        if(best)
+        {
+            price = best->price;
+        }
+        return best != nullptr;
+    }
+
+    if(bid_depth.empty())
+    {
+        return 0;
+    }
+    price = bid_depth.begin()->first;
+    return 1;
+}
+
+int AP::orderbook::bestOffer(int& price) const
+{
+    if(tick_size)
+    {
+        if(best_offer_level == UINT32_MAX)
+        {
+            return 0;
+        }
+        price = min_price + static_cast<int>(best_offer_level) * tick_size;
+        return 1;
+    }
+
+    if(small_layout)
+    {
+        const small_order* best = firstSmallOrder(2);
+        if(best)
+        {
+            price = best->price;
+        }
+        return best != nullptr;
+    }
+
+    if(offer_depth.empty())
+    {
+        return 0;
+    }
+    price = offer_depth.begin()->first;
+    return 1;
+}
+
+int AP::orderbook::print()
+{
+    AP::output_sink out;
+    return print(out) && out.flush();
+}
+
+int AP::orderbook::print(AP::output_sink& out)
+{
+    if(empty())
+    {
+        out.put("Orderbook for this item is empty\n");
+        return out.good();
+    }
+
+    if(tick_size)
+    {
+        return printLevels(out);
+    }
+    if(small_layout)
+    {
+        //small_rank is already in print order: bids best first, then offers
+        out.put("Buy:\n");
+        uint32_t r = 0;
+        for(; r < live_orders && small_orders[small_rank[r]].side == 1; r++)
+        {
+            out.order(small_orders[small_rank[r]].auction_ID.view(), small_orders[small_rank[r]].price);
+        }
+        out.put("Sell:\n");
+        for(; r < live_orders; r++)
+        {
+            out.order(small_orders[small_rank[r]].auction_ID.view(), small_orders[small_rank[r]].price);
+        }
+        return out.good();
+    }
+
+    //the depth maps are in price order and each price queue in arrival order, so nothing needs sorting
+    out.put("Buy:\n");
+    for(auto& depth: bid_depth)
+    {
+        for(uint32_t s = depth.second.head; s != UINT32_MAX; s = orders[s].next)
+        {
+            out.order(orders[s].auction_ID.view(), depth.first);
+        }
+    }
+    out.put("Sell:\n");
+    for(auto& depth: offer_depth)
+    {
+        for(uint32_t s = depth.second.head; s != UINT32_MAX; s = orders[s].next)
+        {
+            out.order(orders[s].auction_ID.view(), depth.first);
+        }
+    }
+
+    return out.good();
+}
+
+
+// small orderbook functions:
+
+//Returns 1 (with the handle) when the order was stored or is already live, -1 when every entry is taken
+int AP::orderbook::addSmallOrder(std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    uint32_t free_slot = small_book_orders;
+    for(uint32_t slot = 0; slot < small_book_orders; slot++)
+    {
+        const small_order& entry = small_orders[slot];
+        if(entry.generation == 0)
+        {
+            free_slot = (free_slot == small_book_orders) ? slot : free_slot;
+        }
+        else if(entry.auction_ID.view() == auction_ID)
+        {
+            //existing order is kept, as in the hashed layout
+            handle.slot = slot;
+            handle.generation = entry.generation;
+            return 1;
+        }
+    }
+    if(free_slot == small_book_orders)
+    {
+        return -1;
+    }
+
+    small_order& entry = small_orders[free_slot];
+    entry.auction_ID = AP::order_id(auction_ID);
+    entry.side = side;
+    entry.price = price;
+    entry.quantity = quantity;
+    entry.generation = takeGeneration();
+    rankSmallOrder(free_slot);
+
+    handle.slot = free_slot;
+    handle.generation = entry.generation;
+    return 1;
 }
 
-int AP::AuctionPrices::deleteOrder(const char* item_ID, const char* auction_ID)
+int AP::orderbook::deleteSmallOrder(std::string_view auction_ID)
 {
-    return Library[(item_ID)].deleteOrder(auction_ID);
+    for(uint32_t r = 0; r < live_orders; r++)
+    {
+        if(small_orders[small_rank[r]].auction_ID.view() == auction_ID)
+        {
+            removeSmallOrder(small_rank[r]);
+            return 1;
+        }
+    }
+    return 0;
 }
 
-int AP::AuctionPrices::print()
+int AP::orderbook::amendSmallOrder(std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle)
 {
-    int print_status = 1;
-    for(auto& i: Library)
+    for(uint32_t r = 0; r < live_orders; r++)
     {
-        std::cout<<i.first<<":\n";
-        print_status = i.second.print();
-        if(print_status == 0)
+        uint32_t slot = small_rank[r];
+        small_order& entry = small_orders[slot];
+        if(entry.auction_ID.view() != auction_ID)
         {
-            return 0;
+            continue;
         }
-        //std::cout<<"\n";
+        quantity = quantity ? quantity : entry.quantity;
+        bool keeps_place = (price == entry.price && quantity <= entry.quantity);
+        entry.quantity = quantity;
+        if(!keeps_place)
+        {
+            unrankSmallOrder(slot);
+            entry.price = price;
+            entry.generation = takeGeneration();
+            rankSmallOrder(slot);
+        }
+        handle.slot = slot;
+        handle.generation = entry.generation;
+        return 1;
+    }
+    return 0;
+}
+
+//Enters slot in small_rank behind every order with the same or a better price on its side
+void AP::orderbook::rankSmallOrder(uint32_t slot)
+{
+    const small_order& entry = small_orders[slot];
+    uint32_t position = 0;
+    while(position < live_orders)
+    {
+        const small_order& ahead = small_orders[small_rank[position]];
+        bool behind = (ahead.side < entry.side)
+                      || (ahead.side == entry.side && (entry.side == 1 ? ahead.price >= entry.price : ahead.price <= entry.price));
+        if(!behind)
+        {
+            break;
+        }
+        position++;
+    }
+    for(uint32_t r = live_orders; r > position; r--)
+    {
+        small_rank[r] = small_rank[r - 1];
+    }
+    small_rank[position] = static_cast<uint8_t>(slot);
+    live_orders++;
+}
+
+void AP::orderbook::unrankSmallOrder(uint32_t slot)
+{
+    uint32_t r = 0;
+    while(small_rank[r] != slot)
+    {
+        r++;
+    }
+    for(; r + 1 < live_orders; r++)
+    {
+        small_rank[r] = small_rank[r + 1];
+    }
+    live_orders--;
+}
+
+void AP::orderbook::removeSmallOrder(uint32_t slot)
+{
+    unrankSmallOrder(slot);
+    small_orders[slot].generation = 0;
+}
+
+const AP::orderbook::small_order* AP::orderbook::firstSmallOrder(int side) const
+{
+    for(uint32_t r = 0; r < live_orders; r++)
+    {
+        if(small_orders[small_rank[r]].side == side)
+        {
+            return &small_orders[small_rank[r]];
+        }
+    }
+    return nullptr;
+}
+
+//Moves the inline orders into the pool, index and depth maps, keeping their slots and generations
+void AP::orderbook::promoteSmall()
+{
+    small_layout = false;
+    orders.reserve(2 * small_book_orders);
+    index.reserve(2 * small_book_orders);
+    for(uint32_t slot = 0; slot < small_book_orders; slot++)
+    {
+        const small_order& entry = small_orders[slot];
+        order_node node = order_node();
+        node.auction_ID = entry.auction_ID;
+        node.side = static_cast<uint8_t>(entry.side);
+        node.price = entry.price;
+        node.quantity = entry.quantity;
+        node.generation = entry.generation;
+        orders.push_back(node);
+        if(entry.generation == 0)
+        {
+            free_slots.push_back(slot);
+            continue;
+        }
+        index.emplace(entry.auction_ID, order_ref{slot, entry.generation});
+    }
+    //queued in rank order, which is arrival order within a price
+    for(uint32_t r = 0; r < live_orders; r++)
+    {
+        const small_order& entry = small_orders[small_rank[r]];
+        pushQueue(entry.side == 1 ? bid_depth[entry.price] : offer_depth[entry.price], small_rank[r]);
     }
+}
+
+
+// tick-indexed orderbook functions:
+
+//Occupancy bitmaps hold one bit per price level, so a walk skips 64 empty levels per word.
+template<typename Bitmap>
+static uint32_t nextOccupiedUp(const Bitmap& occupied, uint32_t from, uint32_t num_levels)
+{
+    if(from >= num_levels)
+    {
+        return UINT32_MAX;
+    }
+    size_t word = from / 64;
+    uint64_t bits = occupied[word] & (~0ULL << (from % 64));
+    while(bits == 0)
+    {
+        if(++word == occupied.size())
+        {
+            return UINT32_MAX;
+        }
+        bits = occupied[word];
+    }
+    return static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits));
+}
+
+template<typename Bitmap>
+static uint32_t nextOccupiedDown(const Bitmap& occupied, uint32_t from)
+{
+    if(from == UINT32_MAX)
+    {
+        return UINT32_MAX;
+    }
+    size_t word = from / 64;
+    uint64_t bits = occupied[word] & (~0ULL >> (63 - from % 64));
+    while(bits == 0)
+    {
+        if(word-- == 0)
+        {
+            return UINT32_MAX;
+        }
+        bits = occupied[word];
+    }
+    return static_cast<uint32_t>(word * 64 + 63 - __builtin_clzll(bits));
+}
+
+//Level of price in the configured range; false for off-tick and out-of-range prices
+bool AP::orderbook::levelOf(int price, uint32_t& level) const
+{
+    int64_t offset = static_cast<int64_t>(price) - min_price;
+    if(offset < 0 || offset % tick_size != 0 || offset / tick_size >= static_cast<int64_t>(num_levels))
+    {
+        return false;
+    }
+    level = static_cast<uint32_t>(offset / tick_size);
+    return true;
+}
+
+int AP::orderbook::addLevelOrder(std::string_view auction_ID, size_t hash, int side, int price, uint32_t quantity, AP::order_handle& handle)
+{
+    if(side != 1 && side != 2)
+    {
+        return 0;
+    }
+    uint32_t level;
+    if(!levelOf(price, level))
+    {
+        return 0;
+    }
+
+    uint32_t slot = free_slots.empty() ? static_cast<uint32_t>(orders.size()) : free_slots.back();
+    order_ref ref = {slot, next_generation};
+
+    auto inserted = index.emplace_hashed(hash, auction_ID, ref);
+    if(!inserted.second)
+    {
+        if(isLive(inserted.first->second))
+        {
+            //existing order is kept, as in the hashed layout
+            handle.slot = inserted.first->second.slot;
+            handle.generation = inserted.first->second.generation;
+            return 1;
+        }
+        inserted.first->second = ref;
+        stale_refs--;
+    }
+
+    acquireSlot(auction_ID, side, price, quantity);
+    order_node& node = orders.write(slot);
+    node.level = static_cast<uint16_t>(level);
+    linkLevelOrder(slot);
+
+    handle.slot = ref.slot;
+    handle.generation = ref.generation;
     return 1;
 }
 
+void AP::orderbook::linkLevelOrder(uint32_t slot)
+{
+    order_node& node = orders.write(slot);
+    pool_vector<price_level>& levels = (node.side == 1) ? bid_levels : offer_levels;
+    price_level& pl = levels[node.level];
 
-AP::orderbook::orderbook()
+    if(pl.count == 0)
+    {
+        pool_vector<uint64_t>& occupied = (node.side == 1) ? bid_occupied : offer_occupied;
+        occupied[node.level / 64] |= (1ULL << (node.level % 64));
+
+        if(node.side == 1 && (best_bid_level == UINT32_MAX || node.level > best_bid_level))
+        {
+            best_bid_level = node.level;
+        }
+        else if(node.side == 2 && node.level < best_offer_level)
+        {
+            best_offer_level = node.level;
+        }
+    }
+    pushQueue(pl, slot);
+    (node.side == 1 ? bid_volume : offer_volume).add(node.level, node.quantity);
+}
+
+void AP::orderbook::unlinkLevelOrder(uint32_t slot)
 {
+    const order_node& node = orders[slot];
+    pool_vector<price_level>& levels = (node.side == 1) ? bid_levels : offer_levels;
+    price_level& pl = levels[node.level];
+
+    unlinkQueue(pl, slot);
+    (node.side == 1 ? bid_volume : offer_volume).add(node.level, -static_cast<int64_t>(node.quantity));
+    if(pl.count == 0)
+    {
+        pool_vector<uint64_t>& occupied = (node.side == 1) ? bid_occupied : offer_occupied;
+        occupied[node.level / 64] &= ~(1ULL << (node.level % 64));
 
+        //the best level only moves when its last order leaves
+        if(node.side == 1 && node.level == best_bid_level)
+        {
+            best_bid_level = (node.level == 0) ? UINT32_MAX : nextOccupiedDown(bid_occupied, node.level - 1);
+        }
+        else if(node.side == 2 && node.level == best_offer_level)
+        {
+            best_offer_level = nextOccupiedUp(offer_occupied, node.level + 1, num_levels);
+        }
+    }
 }
 
-// flat_hash_map orderbook functions:
+int AP::orderbook::printLevels(AP::output_sink& out)
+{
+    //levels are already in price order, so the walk is linear in the number of levels and needs no sort
+    out.put("Buy:\n");
+    for(uint32_t l = nextOccupiedDown(bid_occupied, num_levels - 1); l != UINT32_MAX; l = (l == 0) ? UINT32_MAX : nextOccupiedDown(bid_occupied, l - 1))
+    {
+        int price = min_price + static_cast<int>(l) * tick_size;
+        for(uint32_t s = bid_levels[l].head; s != UINT32_MAX; s = orders[s].next)
+        {
+            out.order(orders[s].auction_ID.view(), price);
+        }
+    }
+    out.put("Sell:\n");
+    for(uint32_t l = nextOccupiedUp(offer_occupied, 0, num_levels); l != UINT32_MAX; l = nextOccupiedUp(offer_occupied, l + 1, num_levels))
+    {
+        int price = min_price + static_cast<int>(l) * tick_size;
+        for(uint32_t s = offer_levels[l].head; s != UINT32_MAX; s = orders[s].next)
+        {
+            out.order(orders[s].auction_ID.view(), price);
+        }
+    }
+
+    return out.good();
+}
 
-int inline AP::orderbook::addNewOrder(const char* auction_ID, int side, int price)
+//the occupied level after level on side, walking away from the best price; UINT32_MAX past the last one
+uint32_t AP::orderbook::nextLevel(int side, uint32_t level) const
 {
     if(side == 1)
     {
-        bids.insert(std::make_pair((auction_ID), price));
-        return 1;
+        return (level == 0) ? UINT32_MAX : nextOccupiedDown(bid_occupied, level - 1);
     }
-    else if(side == 2)
+    return nextOccupiedUp(offer_occupied, level + 1, num_levels);
+}
+
+uint32_t AP::orderbook::topN(int side, AP::depth_level* levels, uint32_t n) const
+{
+    if(side != 1 && side != 2)
     {
-        offers.insert(std::make_pair((auction_ID), price));
-        return 1;
+        return 0;
     }
-
-    return 0;
+    uint32_t filled = 0;
+    if(tick_size)
+    {
+        const pool_vector<price_level>& side_levels = (side == 1) ? bid_levels : offer_levels;
+        for(uint32_t l = (side == 1) ? best_bid_level : best_offer_level; l != UINT32_MAX && filled < n; l = nextLevel(side, l))
+        {
+            levels[filled++] = {min_price + static_cast<int>(l) * tick_size, side_levels[l].count, side_levels[l].quantity};
+        }
+    }
+    else if(small_layout)
+    {
+        //small_rank lists each side best price first, so the orders of a price are next to each other
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.side != side)
+            {
+                continue;
+            }
+            if(filled > 0 && levels[filled - 1].price == entry.price)
+            {
+                levels[filled - 1].orders++;
+                levels[filled - 1].quantity += entry.quantity;
+            }
+            else if(filled < n)
+            {
+                levels[filled++] = {entry.price, 1, entry.quantity};
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+    else if(side == 1)
+    {
+        for(auto level = bid_depth.begin(); level != bid_depth.end() && filled < n; ++level)
+        {
+            levels[filled++] = {level->first, level->second.count, level->second.quantity};
+        }
+    }
+    else
+    {
+        for(auto level = offer_depth.begin(); level != offer_depth.end() && filled < n; ++level)
+        {
+            levels[filled++] = {level->first, level->second.count, level->second.quantity};
+        }
+    }
+    return filled;
 }
 
-int inline AP::orderbook::deleteOrder(const char* auction_ID)
+uint32_t AP::orderbook::topN(int side, AP::depth_order* top, uint32_t n) const
 {
-    if(bids.empty() && offers.empty())
+    if(side != 1 && side != 2)
     {
-        //some message
         return 0;
     }
-    
-    if(bids.find(auction_ID)!=bids.end())
+    uint32_t filled = 0;
+    if(small_layout)
     {
-        bids.erase(auction_ID);
-        return 1;
+        for(uint32_t r = 0; r < live_orders && filled < n; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            if(entry.side == side)
+            {
+                top[filled++] = {entry.auction_ID, entry.price, entry.quantity};
+            }
+        }
+        return filled;
     }
-    else if(offers.find(auction_ID)!=offers.end())
+
+    //every price's orders are queued in arrival order, so the walk is level by level, then down each queue
+    auto take = [&](const price_level& queue)
     {
-        offers.erase(auction_ID);
-        return 1;
+        for(uint32_t s = queue.head; s != UINT32_MAX && filled < n; s = orders[s].next)
+        {
+            top[filled++] = {orders[s].auction_ID, orders[s].price, orders[s].quantity};
+        }
+    };
+    if(tick_size)
+    {
+        const pool_vector<price_level>& side_levels = (side == 1) ? bid_levels : offer_levels;
+        for(uint32_t l = (side == 1) ? best_bid_level : best_offer_level; l != UINT32_MAX && filled < n; l = nextLevel(side, l))
+        {
+            take(side_levels[l]);
+        }
     }
-    return 0;
+    else if(side == 1)
+    {
+        for(auto level = bid_depth.begin(); level != bid_depth.end() && filled < n; ++level)
+        {
+            take(level->second);
+        }
+    }
+    else
+    {
+        for(auto level = offer_depth.begin(); level != offer_depth.end() && filled < n; ++level)
+        {
+            take(level->second);
+        }
+    }
+    return filled;
 }
 
-int AP::orderbook::print()
+
+// snapshot functions:
+
+AP::book_snapshot AP::orderbook::snapshot() const
 {
-    if(bids.empty() && offers.empty())
+    AP::book_snapshot view;
+    view.pages = orders.share();
+    view.num_slots = orders.size();
+    if(small_layout)
     {
-        std::cout<<"Orderbook for this item is empty\n";
-        return 1;
+        //a few orders: copying them is cheaper than giving the book a pool page to share
+        view.small_orders.reserve(live_orders);
+        for(uint32_t r = 0; r < live_orders; r++)
+        {
+            const small_order& entry = small_orders[small_rank[r]];
+            order_node copy = order_node();
+            copy.auction_ID = entry.auction_ID;
+            copy.side = static_cast<uint8_t>(entry.side);
+            copy.price = entry.price;
+            copy.quantity = entry.quantity;
+            copy.generation = entry.generation;
+            view.small_orders.push_back(copy);
+        }
+    }
+    view.live_orders = live_orders;
+    view.bid_status = bestBid(view.best_bid);
+    view.offer_status = bestOffer(view.best_offer);
+    view.tick_size = tick_size;
+    view.min_price = min_price;
+    view.max_price = tick_size ? min_price + static_cast<int>(num_levels - 1) * tick_size : 0;
+    return view;
+}
+
+AP::book_snapshot::book_snapshot()
+    : num_slots(0), live_orders(0), bid_status(0), best_bid(0), offer_status(0), best_offer(0),
+      tick_size(0), min_price(0), max_price(0)
+{
+
+}
+
+int AP::book_snapshot::bestBid(int& price) const
+{
+    if(bid_status)
+    {
+        price = best_bid;
+    }
+    return bid_status;
+}
+
+int AP::book_snapshot::bestOffer(int& price) const
+{
+    if(offer_status)
+    {
+        price = best_offer;
     }
+    return offer_status;
+}
+
+bool AP::book_snapshot::empty() const
+{
+    return live_orders == 0;
+}
+
+uint32_t AP::book_snapshot::size() const
+{
+    return live_orders;
+}
 
-    std::vector<std::pair<int,std::string>> price_ordered_bids;
-    std::vector<std::pair<int,std::string>> price_ordered_offers;
+int AP::book_snapshot::tickLayout(int& tick_size, int& min_price, int& max_price) const
+{
+    if(this->tick_size == 0)
+    {
+        return 0;
+    }
+    tick_size = this->tick_size;
+    min_price = this->min_price;
+    max_price = this->max_price;
+    return 1;
+}
 
-    for(auto& p: bids)
+void AP::book_snapshot::ordered(std::vector<const node*>& bids, std::vector<const node*>& offers) const
+{
+    typedef AP::cow_pool<node> pool;
+    for(uint32_t s = 0; s < num_slots; s++)
     {
-        price_ordered_bids.push_back(std::make_pair(p.second, p.first));
+        const node& order = pages[s >> pool::page_bits]->items[s & (pool::page_size - 1)];
+        if(order.generation == 0)
+        {
+            continue;
+        }
+        (order.side == 1 ? bids : offers).push_back(&order);
     }
-    for(auto& p: offers)
+    for(const node& order: small_orders)
     {
-        price_ordered_offers.push_back(std::make_pair(p.second, p.first));
+        (order.side == 1 ? bids : offers).push_back(&order);
     }
-    std::sort(price_ordered_bids.begin(),price_ordered_bids.end(), 
-                [](std::pair<int,std::string> p1, std::pair<int,std::string> p2)
+    //the generation of an order grows with arrival order, so it breaks price ties the way the book's FIFO does
+    std::sort(bids.begin(), bids.end(),
+                [](const node* n1, const node* n2)
                 {
-                    return (p1.first>p2.first);
+                    return (n1->price != n2->price) ? (n1->price > n2->price) : (n1->generation < n2->generation);
                 });
-    std::sort(price_ordered_offers.begin(),price_ordered_offers.end(), 
-                [](std::pair<int,std::string> p1, std::pair<int,std::string> p2)
+    std::sort(offers.begin(), offers.end(),
+                [](const node* n1, const node* n2)
                 {
-                    return (p1.first<p2.first);
+                    return (n1->price != n2->price) ? (n1->price < n2->price) : (n1->generation < n2->generation);
                 });
-    
-    
-    std::cout<<"Buy:\n";
-    for(auto&i :price_ordered_bids)
+}
+
+int AP::book_snapshot::print() const
+{
+    AP::output_sink out;
+    return print(out) && out.flush();
+}
+
+int AP::book_snapshot::print(AP::output_sink& out) const
+{
+    if(empty())
+    {
+        out.put("Orderbook for this item is empty\n");
+        return out.good();
+    }
+
+    std::vector<const node*> bids;
+    std::vector<const node*> offers;
+    ordered(bids, offers);
+
+    out.put("Buy:\n");
+    for(const node* order: bids)
     {
-        std::cout<<i.second<<" "<<i.first<<"\n";
+        out.order(order->auction_ID.view(), order->price);
     }
-    std::cout<<"Sell:\n";
-    for(auto& i: price_ordered_offers)
+    out.put("Sell:\n");
+    for(const node* order: offers)
     {
-        std::cout<<i.second<<" "<<i.first<<"\n";
+        out.order(order->auction_ID.view(), order->price);
     }
+    return out.good();
+}
+
+int AP::house_snapshot::print() const
+{
+    AP::output_sink out;
+    return print(out) && out.flush();
+}
 
+int AP::house_snapshot::print(AP::output_sink& out) const
+{
+    for(auto& book: books)
+    {
+        out.put(book.first).put(":\n");
+        if(book.second.print(out) == 0)
+        {
+            return 0;
+        }
+    }
     return 1;
 }
+
+AP::book_snapshot AP::AuctionPrices::snapshot(std::string_view item_ID) const
+{
+    const AP::orderbook* book = findBook(item_ID);
+    return book ? book->snapshot() : AP::book_snapshot();
+}
+
+AP::house_snapshot AP::AuctionPrices::snapshot() const
+{
+    AP::house_snapshot house;
+    house.sequence = 0;
+    house.books.reserve(books.size());
+    for(uint32_t i = 0; i < universe.num_ids; i++)
+    {
+        house.books.emplace_back(std::string(universe.ids[i]), books[i].snapshot());
+    }
+    for(auto& i: Library)
+    {
+        house.books.emplace_back(i.first, books[i.second].snapshot());
+    }
+    return house;
+}
+
+void AP::AuctionPrices::publishSnapshot(uint64_t sequence)
+{
+    std::shared_ptr<AP::house_snapshot> house = std::make_shared<AP::house_snapshot>(snapshot());
+    house->sequence = sequence;
+    std::atomic_store(&published, std::shared_ptr<const AP::house_snapshot>(std::move(house)));
+}
+
+std::shared_ptr<const AP::house_snapshot> AP::AuctionPrices::latestSnapshot() const
+{
+    return std::atomic_load(&published);
+}
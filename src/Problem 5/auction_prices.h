@@ -1,39 +1,535 @@
 #ifndef AUCTIONPRICES_H_
 #define AUCTIONPRICES_H_
 
+#include "arena.h"
+#include "cow_pool.h"
+#include "fenwick_tree.h"
 #include "flat_hash_map.hpp"
+#include "inline_id.h"
+#include "item_universe.h"
+#include "latency_stats.h"
+#include "output_sink.h"
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace AP
 {
+    //Returned by addNewOrder() so a caller can delete the order later without passing any strings.
+    //slot indexes the book's order pool; generation is bumped whenever the slot is reused, so a stale
+    //handle is rejected instead of deleting someone else's order.
+    struct order_handle
+    {
+        uint32_t book;
+        uint32_t slot;
+        uint32_t generation;
+    };
+
+    //What an order_op, a journal record or a ShardedAuctionPrices queue entry asks for. The values are part
+    //of the journal format.
+    enum class order_action : uint8_t
+    {
+        none = 0,
+        add = 1,            //addNewOrder()
+        remove = 2,         //deleteOrder()
+        reduce = 3,         //reduceOrder()
+        amend = 4,          //amendOrder()
+        configure = 5,      //configureItem(); journal records only
+        snapshot = 6,       //publish a snapshot; ShardedAuctionPrices queue only
+        compact = 7         //compact(); ShardedAuctionPrices queue only
+    };
+
+    //One entry of a batch passed to AuctionPrices::applyBatch(); action is add, remove, reduce or amend (side is
+    //only read by adds, price by adds and amends; quantity of a reduction is the amount taken off).
+    //applyBatch() fills in status, and for adds and amends the handle.
+    struct order_op
+    {
+        std::string_view item_ID;
+        std::string_view auction_ID;
+        AP::order_action action;
+        int side;
+        int price;
+        uint32_t quantity = 1;
+        int status;
+        AP::order_handle handle;
+    };
+
+    //A trade made in matching mode (see AuctionPrices::attachFillListener()). An incoming order that crosses the
+    //book trades with the resting orders one at a time, best price and then earliest arrival first; each trade
+    //is one fill. resting is the resting order's handle: still valid while resting_left > 0, stale once the
+    //order was filled.
+    struct fill_event
+    {
+        std::string_view item_ID;
+        std::string_view incoming_ID;
+        AP::order_id resting_ID;
+        AP::order_handle resting;
+        int side;               //side of the incoming order
+        int price;              //the resting order's price, which the trade is made at
+        uint32_t quantity;      //traded
+        uint32_t resting_left;  //quantity the resting order keeps
+    };
+
+    class fill_listener
+    {
+        public:
+            virtual ~fill_listener() = default;
+            //called on the thread that made the trade, before the add that caused it returns
+            virtual void onFill(const AP::fill_event& fill) = 0;
+    };
+
+    //Indicative result of a uniform-price call auction over an item's resting orders (see orderbook::clearingPrice())
+    struct auction_clearing
+    {
+        int price;
+        uint64_t volume;        //quantity that would execute at price, on each side
+        int64_t imbalance;      //bid minus offer quantity willing to trade at price: > 0 buy surplus, < 0 sell surplus
+    };
+
+    //One price of a side, as written by topN()
+    struct depth_level
+    {
+        int price;
+        uint32_t orders;
+        uint64_t quantity;
+    };
+
+    //One resting order, as written by topN(); the auction_ID is copied, so it outlives changes to the book
+    struct depth_order
+    {
+        AP::order_id auction_ID;
+        int price;
+        uint32_t quantity;
+    };
+
+    class book_snapshot;
+    class journal;
+
     class orderbook
     {
         private:
-            ska::flat_hash_map <std::string, int> bids;
-            ska::flat_hash_map <std::string, int> offers;
+            friend class book_snapshot;
+
+            //every container of a book allocates through the session arena, if one was given
+            template<typename T>
+            using pool_vector = std::vector<T, AP::arena_allocator<T>>;
+
+            //auction_ID -> pool slot of the order, tagged with the generation it was stored under.
+            //Entries whose order was deleted through a handle go stale and are dropped lazily.
+            struct order_ref
+            {
+                uint32_t slot;
+                uint32_t generation;
+            };
+
+            //One index for both sides and both layouts: the pool node records the side and where the
+            //order sits, so a delete is a single lookup followed by an unlink.
+            //Keys are stored inline and looked up by string_view, so add/delete never allocate a string.
+            ska::flat_hash_map <AP::order_id, order_ref, AP::id_hash, AP::id_equal, AP::arena_allocator<std::pair<AP::order_id, order_ref>>> index;
+
+            //Orders resting at one price, oldest first, chained through the order pool (prev/next of order_node).
+            //count is the number of orders, quantity their total size.
+            struct price_level
+            {
+                uint32_t head;
+                uint32_t tail;
+                uint32_t count;
+                uint64_t quantity;
+            };
+
+            //price -> the orders at that price, kept current on every add/delete so the top of book of the
+            //hashed layout is the first entry of each map, and the order to match first is its head
+            std::map<int, price_level, std::greater<int>, AP::arena_allocator<std::pair<const int, price_level>>> bid_depth;
+            std::map<int, price_level, std::less<int>, AP::arena_allocator<std::pair<const int, price_level>>> offer_depth;
+
+            //Order pool shared by both layouts. generation is 0 while the slot is free, and otherwise grows with
+            //arrival order. The pool is copy-on-write, so snapshots can share it (see snapshot()).
+            //level (tick layout only) and side are narrowed to 3 bytes, so the node carries a quantity and still
+            //takes 56 bytes. price stays a full int: the hashed layout needs it.
+            struct order_node
+            {
+                AP::order_id auction_ID;
+                int price;
+                uint32_t quantity;
+                uint32_t prev;
+                uint32_t next;
+                uint32_t generation;
+                uint16_t level;
+                uint8_t side;
+            };
+
+            AP::cow_pool<order_node> orders;
+            pool_vector<uint32_t> free_slots;
+            uint32_t next_generation;
+            uint32_t live_orders;
+            uint32_t stale_refs;
+            //most live orders since the last shrink(); a book that drains far below it shrinks on its own
+            uint32_t peak_orders;
+
+            //Tick-indexed layout (README improvement #2). Used instead of bid_depth/offer_depth when the book is
+            //constructed with a tick size and price range. Level i holds the orders priced min_price + i*tick_size,
+            //chained in arrival order through the order pool. Prices are converted to levels when an order
+            //arrives (off-tick and out-of-range prices are rejected there). The node keeps its price as well, and
+            //amendOrder(), topN() and snapshots read it from there.
+            int tick_size;
+            int min_price;
+            uint32_t num_levels;
+
+            pool_vector<price_level> bid_levels;
+            pool_vector<price_level> offer_levels;
+            pool_vector<uint64_t> bid_occupied;
+            pool_vector<uint64_t> offer_occupied;
+            //resting quantity per level, for the cumulative depth queries
+            AP::fenwick_tree bid_volume;
+            AP::fenwick_tree offer_volume;
+            uint32_t best_bid_level;
+            uint32_t best_offer_level;
+
+            //Small layout. A hashed book starts out keeping up to small_book_orders orders inline, with the pool,
+            //index and depth maps left unallocated, so a thinly traded item costs little more than the orderbook
+            //itself. Entry i stands for pool slot i (generation 0 = free). small_rank lists the live entries in
+            //priority order: bids best first, then offers best first, arrival order within a price. The book
+            //moves to the hashed layout when an order arrives while every entry is taken, or when it is reserved
+            //for more orders. Slots and generations carry over, so handles stay valid.
+            static constexpr uint32_t small_book_orders = 8;
+
+            struct small_order
+            {
+                AP::order_id auction_ID;
+                int side;
+                int price;
+                uint32_t quantity;
+                uint32_t generation;
+            };
+
+            small_order small_orders[small_book_orders];
+            uint8_t small_rank[small_book_orders];
+            bool small_layout;
+
+            int addSmallOrder(std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle);
+            int deleteSmallOrder(std::string_view auction_ID);
+            int amendSmallOrder(std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle);
+            void rankSmallOrder(uint32_t slot);
+            void unrankSmallOrder(uint32_t slot);
+            void removeSmallOrder(uint32_t slot);
+            const small_order* firstSmallOrder(int side) const;
+            void promoteSmall();
+
+            uint32_t takeGeneration();
+            uint32_t acquireSlot(std::string_view auction_ID, int side, int price, uint32_t quantity);
+            void removeOrder(uint32_t slot);
+            void linkDepthOrder(uint32_t slot);
+            void unlinkDepthOrder(uint32_t slot);
+            void pushQueue(price_level& queue, uint32_t slot);
+            void unlinkQueue(price_level& queue, uint32_t slot);
+            bool isResting(std::string_view auction_ID, size_t hash) const;
+            uint32_t oldestOrder(int side, uint32_t& generation) const;
+            void reduceSlot(uint32_t slot, uint32_t quantity);
+            bool isLive(const order_ref& ref) const;
+            void sweepStaleRefs();
+            void shrinkIfDrained();
+
+            int addHashedOrder(std::string_view auction_ID, size_t hash, int side, int price, uint32_t quantity, AP::order_handle& handle);
+            int deleteHashedOrder(std::string_view auction_ID, size_t hash);
+            int reduceHashedOrder(std::string_view auction_ID, size_t hash, uint32_t quantity);
+            int amendHashedOrder(std::string_view auction_ID, size_t hash, int price, uint32_t quantity, AP::order_handle& handle);
+
+            template<typename Visitor>
+            void forEachCrossingLevel(Visitor&& visit) const;
+            void depthAt(int price, uint64_t& bids, uint64_t& offers) const;
+
+            bool levelOf(int price, uint32_t& level) const;
+            int addLevelOrder(std::string_view auction_ID, size_t hash, int side, int price, uint32_t quantity, AP::order_handle& handle);
+            void linkLevelOrder(uint32_t slot);
+            void unlinkLevelOrder(uint32_t slot);
+            uint32_t nextLevel(int side, uint32_t level) const;
+            int printLevels(AP::output_sink& out);
         
         public:
+            //a tick-indexed range holds at most this many prices, so an order's level fits its uint16_t field
+            static constexpr uint32_t max_tick_levels = 65536;
+
             orderbook();
+            explicit orderbook(AP::arena* memory);
+            orderbook(int tick_size, int min_price, int max_price, AP::arena* memory = nullptr);
+
+            int addNewOrder(std::string_view auction_ID, int side, int price);
+            int addNewOrder(std::string_view auction_ID, int side, int price, AP::order_handle& handle);
+            //quantity must be at least 1; the other overloads add a quantity of 1
+            int addNewOrder(std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle);
+            int deleteOrder(std::string_view auction_ID); 
+            int deleteOrder(uint32_t slot, uint32_t generation);
+            //Takes quantity off a resting order, which keeps its place in the queue; taking all of it deletes the order
+            int reduceOrder(std::string_view auction_ID, uint32_t quantity);
+            //Replaces a resting order's price and quantity (quantity 0 keeps the current one) in place, with one
+            //index lookup and no erase or re-insert in the auction_ID index. A cut in size at the same price keeps
+            //the order's place in the queue and its handle. A new price or a larger size puts it behind the orders
+            //already at its price, as a new arrival, so it keeps its pool slot but gets a new generation: handle
+            //receives it. Returns 0, and leaves the order alone, if it is not resting or the new price is off the
+            //tick grid.
+            int amendOrder(std::string_view auction_ID, int price, uint32_t quantity = 0);
+            int amendOrder(std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle);
+            //side, price and quantity of a resting order; returns 0 if auction_ID is not resting
+            int restingOrder(std::string_view auction_ID, int& side, int& price, uint32_t& quantity) const;
+            //One step of a matching add: if the order crosses the best opposite price, it trades there with the order
+            //that has rested longest (price-time priority), as much as both have. Returns 1 with fill filled in (but
+            //not its item_ID) and quantity reduced by the traded amount. Returns 0 if nothing trades, including for
+            //an order a plain add would reject and for an auction_ID that already rests in the book.
+            int matchOnce(std::string_view auction_ID, int side, int price, uint32_t& quantity, AP::fill_event& fill);
+            //1 if the pool slot holds a live order with this generation
+            int holdsOrder(uint32_t slot, uint32_t generation) const;
+            //auction_ID of the live order in a pool slot; a delete may free the slot's page, so copy it first
+            std::string_view orderID(uint32_t slot) const;
+            //Applies ops[order[0]], ..., ops[order[count-1]] in that order. hashes is scratch space for count hashes.
+            int applyBatch(AP::order_op* ops, const uint32_t* order, size_t* hashes, uint32_t count);
+
+            int bestBid(int& price) const;
+            int bestOffer(int& price) const;
+
+            //Call auction over the resting orders: the limit price that executes the most quantity, then leaves the
+            //smallest imbalance, then lies on the side of the surplus (highest price for a buy surplus, lowest for
+            //a sell surplus). A tie left after that clears at the middle of the tied prices, rounded down to the
+            //tick grid. Reads the per-price quantities every add/delete keeps current, so it is one pass over
+            //the prices where the book crosses, with no sort. Returns 0 (and leaves result alone) if the book
+            //does not cross.
+            int clearingPrice(AP::auction_clearing& result) const;
+
+            //Quantity resting on side at price or better: bids at or above price, offers at or below it
+            uint64_t depthAtOrBetter(int side, int price) const;
+            //Worst price on side reached by taking quantity from it best price first, i.e. the price a quote must
+            //reach to fill quantity against that side. Returns 0 if the side holds less.
+            //Both are O(log levels) in the tick layout, through a Fenwick tree of the quantity per level, and walk
+            //the prices better than the answer in the other layouts.
+            int priceToFill(int side, uint64_t quantity, int& price) const;
 
-            int addNewOrder(const char* auction_ID, int side, int price);
-            int deleteOrder(const char* auction_ID); 
+            //Best n prices (or orders, in priority order) of side, written to the caller's buffer; returns how many
+            //were written. Every layout already keeps its prices in order (level bitmaps, the depth maps, the
+            //small rank array), so this walks from the best price and stops after n, with no sort or allocation.
+            uint32_t topN(int side, AP::depth_level* levels, uint32_t n) const;
+            uint32_t topN(int side, AP::depth_order* orders, uint32_t n) const;
 
+            //Sizes the order pool and the auction_ID index for expected_orders live orders, so filling the
+            //book up to that many orders does not rehash or grow the pool.
+            void reserve(uint32_t expected_orders);
+            uint32_t capacity() const;
+            //Gives back the memory the live orders do not need (including capacity from reserve()): trailing
+            //free pool pages, the unused part of the auction_ID index and stale index entries. An empty hashed
+            //book returns to the small layout. Live orders keep their slots, so their handles stay valid.
+            void shrink();
+
+            bool empty() const;
+            bool tickIndexed() const;
+            //print() writes to stdout; print(out) formats into a caller's sink (a file, a string, ...)
             int print();
+            int print(AP::output_sink& out);
+
+            //Point-in-time view of the book, cheap enough to take between two orders: it shares the order
+            //pool pages, and the book copies a page the first time it changes it afterwards.
+            AP::book_snapshot snapshot() const;
             
 
     };
 
+    //Snapshot of one book. It holds the book's order pool pages, so it stays valid and unchanged
+    //while the book keeps changing, and can be read and dropped from any thread.
+    class book_snapshot
+    {
+        private:
+            friend class orderbook;
+            typedef AP::orderbook::order_node node;
+
+            AP::cow_pool<node>::shared_pages pages;
+            uint32_t num_slots;
+            //orders of a book in the small layout, copied instead of shared
+            std::vector<node> small_orders;
+            uint32_t live_orders;
+            int bid_status;
+            int best_bid;
+            int offer_status;
+            int best_offer;
+            //tick_size is 0 for the hashed layout
+            int tick_size;
+            int min_price;
+            int max_price;
+
+            //live orders in priority order: best price first, arrival order within a price
+            void ordered(std::vector<const node*>& bids, std::vector<const node*>& offers) const;
+
+        public:
+            book_snapshot();
+
+            int bestBid(int& price) const;
+            int bestOffer(int& price) const;
+            bool empty() const;
+            uint32_t size() const;
+            //returns 1 and the layout of a tick-indexed book, 0 for the hashed layout
+            int tickLayout(int& tick_size, int& min_price, int& max_price) const;
+            //same output as orderbook::print(), orders at a price in arrival order
+            int print() const;
+            int print(AP::output_sink& out) const;
+
+            //Calls visit(auction_ID, side, price, quantity) for every bid and then every offer, in priority order
+            template<typename Visitor>
+            void forEachOrder(Visitor&& visit) const
+            {
+                std::vector<const node*> bids;
+                std::vector<const node*> offers;
+                ordered(bids, offers);
+                for(const node* order: bids)
+                {
+                    visit(order->auction_ID.view(), int(order->side), order->price, order->quantity);
+                }
+                for(const node* order: offers)
+                {
+                    visit(order->auction_ID.view(), int(order->side), order->price, order->quantity);
+                }
+            }
+    };
+
+    //Snapshot of every book of an AuctionPrices, in print() order
+    struct house_snapshot
+    {
+        uint64_t sequence;
+        std::vector<std::pair<std::string, AP::book_snapshot>> books;
+
+        int print() const;
+        int print(AP::output_sink& out) const;
+    };
+
     class AuctionPrices
     {
         private:
-            ska::flat_hash_map <std::string, AP::orderbook> Library;
+            //item_ID -> index into books. Books never move between indexes, which keeps handles valid.
+            ska::flat_hash_map <std::string, uint32_t, AP::id_hash, AP::id_equal, AP::arena_allocator<std::pair<std::string, uint32_t>>> Library;
+            std::vector<AP::orderbook, AP::arena_allocator<AP::orderbook>> books;
+
+            //When the session declares its items up front, they are found through this perfect hash
+            //instead of Library, and item i of the universe owns books[i].
+            AP::item_universe_view universe;
+
+            //session arena handed to every book, or nullptr for the global heap
+            AP::arena* memory;
+
+            //expected orders per item, applied to every book as it is created
+            uint32_t orders_hint;
+
+            //scratch space of applyBatch(), kept between calls so a batch does not allocate
+            std::vector<uint64_t> batch_keys;
+            std::vector<uint32_t> batch_order;
+            std::vector<size_t> batch_hashes;
+
+            //last snapshot handed to readers by publishSnapshot(); only accessed through std::atomic_load/store
+            std::shared_ptr<const AP::house_snapshot> published;
+
+            //item_ID of every Library book, by book index, so a delete by handle can be journaled
+            std::vector<std::string> item_names;
+            //write-ahead journal of accepted orders, or nullptr
+            AP::journal* log;
+            //receives the trades of matching mode; nullptr = orders never trade
+            AP::fill_listener* fills;
+
+            //indexes of books whose items were evicted by compact(), reused by the next new items
+            std::vector<uint32_t> free_books;
+
+#if defined(AP_ENABLE_LATENCY_STATS)
+            //written by the thread that owns this AuctionPrices, including from the const queries
+            mutable AP::latency_stats latency;
+#endif
+
+            std::string_view itemName(uint32_t book) const;
+
+            AP::orderbook* bookFor(std::string_view item_ID, uint32_t& book);
+            AP::orderbook* findBook(std::string_view item_ID);
+            const AP::orderbook* findBook(std::string_view item_ID) const;
+            //the body of addNewOrder() once the book is found: trades in matching mode, then rests and journals
+            //what is left. Not timed, so amendOrder() can use it inside its own latency scope.
+            int placeOrder(AP::orderbook* orders, uint32_t book, std::string_view item_ID, std::string_view auction_ID,
+                           int side, int price, uint32_t quantity, AP::order_handle& handle);
         
         public:
-            int addNewOrder(const char* item_ID, const char* auction_ID, int side, int price);            
-            int deleteOrder(const char* item_ID, const char* auction_ID);
+            AuctionPrices();
+            //memory must outlive the AuctionPrices; releasing it afterwards frees the whole session at once
+            explicit AuctionPrices(AP::arena* memory);
+            //items must be valid(), or std::invalid_argument is thrown: an empty view would silently fall back to the Library lookup
+            explicit AuctionPrices(const AP::item_universe_view& items, AP::arena* memory = nullptr);
+            AuctionPrices(uint32_t expected_items, uint32_t expected_orders_per_item, AP::arena* memory = nullptr);
+
+            int reserve(uint32_t expected_items, uint32_t expected_orders_per_item);
+            int reserveItem(std::string_view item_ID, uint32_t expected_orders);
+
+            int configureItem(std::string_view item_ID, int tick_size, int min_price, int max_price);
+            int addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price);            
+            int addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, AP::order_handle& handle);
+            int addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity, AP::order_handle& handle);
+            int deleteOrder(std::string_view item_ID, std::string_view auction_ID);
+            int deleteOrder(const AP::order_handle& handle);
+            int reduceOrder(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity);
+            //In-place price/quantity replace, see orderbook::amendOrder(). In matching mode an amend that crosses
+            //the book trades like a new order: the order leaves the book and comes back through addNewOrder().
+            int amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity = 0);
+            int amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity, AP::order_handle& handle);
+            int applyBatch(AP::order_op* ops, size_t count);
+
+            //Compaction pass for after a burst: shrinks every book and evicts empty hashed items from Library
+            //(configured items keep their tick layout). Books also shrink on their own once they drain to an
+            //eighth of their peak. Handles into evicted books stay stale after their index is reused.
+            //Returns the number of items evicted.
+            uint32_t compact();
+
+            int bestBid(std::string_view item_ID, int& price) const;
+            int bestOffer(std::string_view item_ID, int& price) const;
+            //indicative uniform clearing price of an item, see orderbook::clearingPrice()
+            int clearingPrice(std::string_view item_ID, AP::auction_clearing& result) const;
+            //cumulative depth of an item, see orderbook::depthAtOrBetter() and orderbook::priceToFill()
+            uint64_t depthAtOrBetter(std::string_view item_ID, int side, int price) const;
+            int priceToFill(std::string_view item_ID, int side, uint64_t quantity, int& price) const;
+            //top of an item's book, see orderbook::topN(); 0 for an unknown item
+            uint32_t topN(std::string_view item_ID, int side, AP::depth_level* levels, uint32_t n) const;
+            uint32_t topN(std::string_view item_ID, int side, AP::depth_order* orders, uint32_t n) const;
 
+            //Prints every book through one buffered sink (stdout for print()), so a full dump costs one
+            //write() per megabyte of text rather than one stream insertion per field.
             int print();
+            int print(AP::output_sink& out);
+
+            //Snapshots are taken on the thread that writes to this AuctionPrices and cost one pointer copy per
+            //1024 pool slots, so ingestion only pauses for that long. Reading them is the reader's cost.
+            AP::book_snapshot snapshot(std::string_view item_ID) const;
+            AP::house_snapshot snapshot() const;
+            //publishSnapshot() is called by the writer and latestSnapshot() by any reporting thread
+            void publishSnapshot(uint64_t sequence = 0);
+            std::shared_ptr<const AP::house_snapshot> latestSnapshot() const;
+
+            //Latency histograms of every add, delete, reduce, amend, applyBatch(), bestBid()/bestOffer() and printed
+            //item, when built with AP_ENABLE_LATENCY_STATS (nullptr otherwise). They can be read and printed from
+            //any thread.
+            const AP::latency_stats* latencyStats() const;
+
+            //Every order (and configureItem()) accepted from now on is also recorded in log; nullptr detaches.
+            //Attach it to an empty AuctionPrices, or right after replayJournal() rebuilt one. While a journal
+            //is attached, item_IDs and auction_IDs longer than 31 characters are rejected.
+            void attachJournal(AP::journal* log);
+
+            //Matching mode: while a listener is attached, an added order (through addNewOrder() or applyBatch())
+            //that crosses the book trades with the best opposite orders, oldest first, until it is filled or no
+            //longer crosses, and only what is left of it rests. Every trade is passed to fills. An order filled
+            //on arrival returns 1 with a handle of generation 0. The journal records a trade as the resting order's
+            //delete or reduceOrder(), and the remainder as an add, so replay rebuilds the book without matching.
+            //In matching mode applyBatch() applies its ops one by one, in batch order.
+            void attachFillListener(AP::fill_listener* fills);
+
+            //Point-in-time snapshot file of the live orders (see README). saveSnapshot(path) takes a snapshot()
+            //first, so like snapshot() it must be called on the writer thread. Another thread can save a published
+            //snapshot instead: saveSnapshot(*prices.latestSnapshot(), path). loadSnapshot() needs an AuctionPrices
+            //without live orders; every book is sized from the file before it is filled.
+            //All return 0 on failure; a failed load may leave part of the file loaded.
+            int saveSnapshot(const char* path) const;
+            static int saveSnapshot(const AP::house_snapshot& house, const char* path);
+            int loadSnapshot(const char* path);
     }; 
 }
 
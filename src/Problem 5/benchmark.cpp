@@ -0,0 +1,308 @@
+#include "auction_prices.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//benchmark [--option=value ...]
+//Runs a generated session against AP::AuctionPrices and reports throughput and per-operation latency percentiles,
+//as the mean and standard deviation over the repetitions. Every repetition replays the same operations on a
+//fresh AuctionPrices. Options (defaults in brackets):
+//    --items        number of items [1000]
+//    --zipf         Zipf exponent of item popularity, 0 = uniform [1.0]
+//    --preload      live orders added before the timed run [100000]
+//    --ops          timed operations [1000000]
+//    --add, --cancel, --top
+//                   relative weights of adds, cancels and top-of-book queries [45, 40, 15]
+//    --levels       distinct prices either side of the mid price [20]
+//    --tick         1 = tick-indexed books (configureItem), 0 = hashed books [0]
+//    --reps         repetitions [5]
+//    --cold         1 = evict the caches every --cold-every operations [0]
+//    --cold-every   operations between evictions in cold mode [1000]
+//    --evict-mb     size of the buffer walked to evict the caches [64]
+//    --seed         workload seed [42]
+namespace
+{
+    struct bench_options
+    {
+        uint32_t items = 1000;
+        double zipf = 1.0;
+        uint32_t preload = 100000;
+        uint32_t ops = 1000000;
+        double add = 45;
+        double cancel = 40;
+        double top = 15;
+        int levels = 20;
+        int tick = 0;
+        uint32_t reps = 5;
+        int cold = 0;
+        uint32_t cold_every = 1000;
+        uint32_t evict_mb = 64;
+        uint32_t seed = 42;
+    };
+
+    //1 = addNewOrder, 2 = deleteOrder, 3 = bestBid/bestOffer (by side)
+    struct bench_op
+    {
+        uint8_t action;
+        int8_t side;
+        uint32_t item;
+        uint32_t order;
+        int price;
+    };
+
+    const char* op_names[4] = {"", "add", "cancel", "top"};
+
+    const int mid_price = 10000;
+
+    struct bench_stats
+    {
+        double mean;
+        double deviation;
+    };
+
+    bench_stats meanDeviation(const std::vector<double>& samples)
+    {
+        double sum = 0;
+        for(double sample: samples)
+        {
+            sum += sample;
+        }
+        double mean = samples.empty() ? 0 : sum / samples.size();
+        double squares = 0;
+        for(double sample: samples)
+        {
+            squares += (sample - mean) * (sample - mean);
+        }
+        return {mean, samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0};
+    }
+
+    //q-th quantile of latencies (reorders them)
+    double percentile(std::vector<uint32_t>& latencies, double q)
+    {
+        if(latencies.empty())
+        {
+            return 0;
+        }
+        std::size_t rank = std::min(latencies.size() - 1, static_cast<std::size_t>(q * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+        return latencies[rank];
+    }
+
+    bool parseOptions(int argc, char** argv, bench_options& options)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            const char* arg = argv[i];
+            const char* value = std::strchr(arg, '=');
+            if(std::strncmp(arg, "--", 2) != 0 || value == nullptr)
+            {
+                return false;
+            }
+            std::string name(arg + 2, value - arg - 2);
+            value++;
+            if(name == "items") options.items = std::strtoul(value, nullptr, 10);
+            else if(name == "zipf") options.zipf = std::strtod(value, nullptr);
+            else if(name == "preload") options.preload = std::strtoul(value, nullptr, 10);
+            else if(name == "ops") options.ops = std::strtoul(value, nullptr, 10);
+            else if(name == "add") options.add = std::strtod(value, nullptr);
+            else if(name == "cancel") options.cancel = std::strtod(value, nullptr);
+            else if(name == "top") options.top = std::strtod(value, nullptr);
+            else if(name == "levels") options.levels = std::atoi(value);
+            else if(name == "tick") options.tick = std::atoi(value);
+            else if(name == "reps") options.reps = std::strtoul(value, nullptr, 10);
+            else if(name == "cold") options.cold = std::atoi(value);
+            else if(name == "cold-every") options.cold_every = std::strtoul(value, nullptr, 10);
+            else if(name == "evict-mb") options.evict_mb = std::strtoul(value, nullptr, 10);
+            else if(name == "seed") options.seed = std::strtoul(value, nullptr, 10);
+            else return false;
+        }
+        return options.items > 0 && options.levels > 0 && options.reps > 0 && options.cold_every > 0
+               && options.add + options.cancel + options.top > 0;
+    }
+
+    //Builds preload + ops operations. Items follow a Zipf distribution, cancels pick a uniformly random live order,
+    //and a cancel with no live order to act on becomes an add.
+    std::vector<bench_op> makeSession(const bench_options& options, uint32_t& num_orders)
+    {
+        std::mt19937_64 random(options.seed);
+        std::vector<double> popularity(options.items);
+        for(uint32_t i = 0; i < options.items; i++)
+        {
+            popularity[i] = 1.0 / std::pow(i + 1.0, options.zipf);
+        }
+        std::discrete_distribution<uint32_t> pick_item(popularity.begin(), popularity.end());
+        std::discrete_distribution<int> pick_action({options.add, options.cancel, options.top});
+        std::uniform_int_distribution<int> pick_offset(0, options.levels - 1);
+        std::bernoulli_distribution pick_side(0.5);
+
+        std::vector<bench_op> session;
+        session.reserve(static_cast<std::size_t>(options.preload) + options.ops);
+        //live orders as (item, order) pairs
+        std::vector<std::pair<uint32_t, uint32_t>> live;
+        num_orders = 0;
+        for(uint64_t i = 0; i < static_cast<uint64_t>(options.preload) + options.ops; i++)
+        {
+            int action = i < options.preload ? 1 : pick_action(random) + 1;
+            bench_op op = {};
+            if(action == 2 && !live.empty())
+            {
+                std::size_t victim = std::uniform_int_distribution<std::size_t>(0, live.size() - 1)(random);
+                op.action = 2;
+                op.item = live[victim].first;
+                op.order = live[victim].second;
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            else if(action == 3)
+            {
+                op.action = 3;
+                op.item = pick_item(random);
+                op.side = pick_side(random) ? 1 : 2;
+            }
+            else
+            {
+                //bids sit at or below the mid price and offers above it, so the book never crosses
+                op.action = 1;
+                op.item = pick_item(random);
+                op.side = pick_side(random) ? 1 : 2;
+                op.price = op.side == 1 ? mid_price - pick_offset(random) : mid_price + 1 + pick_offset(random);
+                op.order = num_orders++;
+                live.emplace_back(op.item, op.order);
+            }
+            session.push_back(op);
+        }
+        return session;
+    }
+
+    //walks a buffer larger than the last-level cache, writing so dirty lines are evicted too
+    void evictCaches(std::vector<char>& buffer)
+    {
+        for(std::size_t i = 0; i < buffer.size(); i += 64)
+        {
+            buffer[i]++;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        std::cerr<<"usage: "<<argv[0]<<" [--items=N] [--zipf=S] [--preload=N] [--ops=N] [--add=W] [--cancel=W] [--top=W]"
+                 <<" [--levels=N] [--tick=0|1] [--reps=N] [--cold=0|1] [--cold-every=N] [--evict-mb=N] [--seed=N]"<<std::endl;
+        return 2;
+    }
+
+    uint32_t num_orders;
+    std::vector<bench_op> session = makeSession(options, num_orders);
+    std::vector<std::string> item_names(options.items);
+    for(uint32_t i = 0; i < options.items; i++)
+    {
+        item_names[i] = "item" + std::to_string(i);
+    }
+    std::vector<std::string> order_names(num_orders);
+    for(uint32_t i = 0; i < num_orders; i++)
+    {
+        order_names[i] = "auction" + std::to_string(i);
+    }
+    std::vector<char> evict_buffer(options.cold ? static_cast<std::size_t>(options.evict_mb) << 20 : 0);
+
+    std::cout<<"items "<<options.items<<", zipf "<<options.zipf<<", preload "<<options.preload<<", ops "<<options.ops
+             <<", mix "<<options.add<<"/"<<options.cancel<<"/"<<options.top<<" (add/cancel/top), "
+             <<(options.tick ? "tick-indexed" : "hashed")<<" books, "<<(options.cold ? "cold" : "warm")<<" cache, "
+             <<options.reps<<" reps"<<std::endl;
+
+    std::vector<double> throughput;
+    //per action: one sample per repetition of each percentile
+    std::vector<double> p50[4], p99[4], p999[4];
+    std::vector<uint32_t> latencies[4];
+    uint64_t sink = 0;
+    for(uint32_t rep = 0; rep < options.reps; rep++)
+    {
+        AP::AuctionPrices AuctionHouse;
+        if(options.tick)
+        {
+            for(uint32_t i = 0; i < options.items; i++)
+            {
+                AuctionHouse.configureItem(item_names[i], 1, mid_price - options.levels, mid_price + options.levels);
+            }
+        }
+        for(uint32_t i = 0; i < options.preload; i++)
+        {
+            const bench_op& op = session[i];
+            AuctionHouse.addNewOrder(item_names[op.item], order_names[op.order], op.side, op.price);
+        }
+        for(auto& action: latencies)
+        {
+            action.clear();
+        }
+
+        //warm mode runs straight on from the preload, with the books already in cache
+        double evicting = 0;
+        auto startTime = std::chrono::steady_clock::now();
+        for(std::size_t i = options.preload; i < session.size(); i++)
+        {
+            const bench_op& op = session[i];
+            if(options.cold && (i - options.preload) % options.cold_every == 0)
+            {
+                auto evictStart = std::chrono::steady_clock::now();
+                evictCaches(evict_buffer);
+                evicting += std::chrono::duration<double>(std::chrono::steady_clock::now() - evictStart).count();
+            }
+            auto opStart = std::chrono::steady_clock::now();
+            int price = 0;
+            switch(op.action)
+            {
+                case 1:
+                    sink += AuctionHouse.addNewOrder(item_names[op.item], order_names[op.order], op.side, op.price);
+                    break;
+                case 2:
+                    sink += AuctionHouse.deleteOrder(item_names[op.item], order_names[op.order]);
+                    break;
+                default:
+                    sink += op.side == 1 ? AuctionHouse.bestBid(item_names[op.item], price)
+                                         : AuctionHouse.bestOffer(item_names[op.item], price);
+                    sink += price;
+                    break;
+            }
+            auto opEnd = std::chrono::steady_clock::now();
+            latencies[op.action].push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(opEnd - opStart).count()));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() - evicting;
+        throughput.push_back(options.ops / seconds / 1e6);
+
+        for(int action = 1; action <= 3; action++)
+        {
+            p50[action].push_back(percentile(latencies[action], 0.5));
+            p99[action].push_back(percentile(latencies[action], 0.99));
+            p999[action].push_back(percentile(latencies[action], 0.999));
+        }
+    }
+
+    bench_stats rate = meanDeviation(throughput);
+    std::cout<<std::fixed<<std::setprecision(3)<<"throughput: "<<rate.mean<<" +- "<<rate.deviation<<" M ops/s"
+             <<" (timer overhead included)"<<std::endl;
+    std::cout<<std::setw(10)<<std::left<<"op"<<std::setw(12)<<"count"<<std::setw(22)<<"p50 ns"<<std::setw(22)<<"p99 ns"
+             <<std::setw(22)<<"p99.9 ns"<<std::endl;
+    for(int action = 1; action <= 3; action++)
+    {
+        auto column = [](const std::vector<double>& samples)
+        {
+            bench_stats stats = meanDeviation(samples);
+            return std::to_string(static_cast<long long>(std::llround(stats.mean))) + " +- "
+                   + std::to_string(static_cast<long long>(std::llround(stats.deviation)));
+        };
+        std::cout<<std::setw(10)<<op_names[action]<<std::setw(12)<<latencies[action].size()<<std::setw(22)<<column(p50[action])
+                 <<std::setw(22)<<column(p99[action])<<std::setw(22)<<column(p999[action])<<std::endl;
+    }
+    //keeps the results observable, so the calls are not optimised away
+    return sink == 0xFFFFFFFFFFFFFFFFull ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+#ifndef COWPOOL_H_
+#define COWPOOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace AP
+{
+    //Copy-on-write pool. Entries live in fixed pages held by shared_ptr, so share() hands out the current
+    //pages for the price of copying one pointer per page. The owner copies a page the first time it writes
+    //to it while a snapshot still holds it, and everything else stays shared.
+    //Pages come from the global heap, not a session arena: the last reference to a page may be dropped by
+    //a reader thread.
+    template<typename T>
+    class cow_pool
+    {
+        public:
+            static constexpr uint32_t page_bits = 10;
+            static constexpr uint32_t page_size = 1u << page_bits;
+
+            struct page
+            {
+                T items[page_size];
+            };
+            typedef std::vector<std::shared_ptr<const page>> shared_pages;
+
+        private:
+            std::vector<std::shared_ptr<page>> pages;
+            uint32_t count;
+
+        public:
+            cow_pool()
+                : count(0)
+            {
+
+            }
+
+            uint32_t size() const
+            {
+                return count;
+            }
+
+            uint32_t capacity() const
+            {
+                return static_cast<uint32_t>(pages.size()) * page_size;
+            }
+
+            //pages are allocated up front, so filling up to n entries allocates nothing
+            void reserve(uint32_t n)
+            {
+                while(capacity() < n)
+                {
+                    pages.push_back(std::make_shared<page>());
+                }
+            }
+
+            //Drops the entries from n on, and the pages that no longer hold any. Snapshots keep the pages they share.
+            void truncate(uint32_t n)
+            {
+                if(n >= count)
+                {
+                    return;
+                }
+                count = n;
+                pages.resize((n + page_size - 1) / page_size);
+                pages.shrink_to_fit();
+            }
+
+            const T& operator[](uint32_t i) const
+            {
+                return pages[i >> page_bits]->items[i & (page_size - 1)];
+            }
+
+            //Every write must go through here. The returned reference stays valid until the next share().
+            T& write(uint32_t i)
+            {
+                std::shared_ptr<page>& target = pages[i >> page_bits];
+                if(target.use_count() != 1)
+                {
+                    target = std::make_shared<page>(*target);
+                }
+                else
+                {
+                    //pairs with the release of the last snapshot reference, so its reads happen before this write
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                }
+                return target->items[i & (page_size - 1)];
+            }
+
+            void push_back(const T& value)
+            {
+                if(count == capacity())
+                {
+                    pages.push_back(std::make_shared<page>());
+                }
+                write(count++) = value;
+            }
+
+            shared_pages share() const
+            {
+                return shared_pages(pages.begin(), pages.begin() + (count + page_size - 1) / page_size);
+            }
+    };
+}
+
+#endif
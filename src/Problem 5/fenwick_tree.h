@@ -0,0 +1,80 @@
+#ifndef FENWICKTREE_H_
+#define FENWICKTREE_H_
+
+#include "arena.h"
+#include <cstdint>
+#include <vector>
+
+namespace AP
+{
+    //Fenwick (binary indexed) tree of quantities over positions 0..size()-1. add() and prefix() are O(log n),
+    //and so is firstReaching(), which walks down the tree instead of binary searching over prefix().
+    class fenwick_tree
+    {
+        private:
+            //1-based: sums[i] covers the positions (i - lowbit(i), i]
+            std::vector<uint64_t, AP::arena_allocator<uint64_t>> sums;
+            //largest power of two not above size(), where firstReaching() starts
+            uint32_t top_step;
+
+        public:
+            explicit fenwick_tree(AP::arena* memory = nullptr)
+                : sums(memory), top_step(0)
+            {
+
+            }
+
+            //n positions, all zero
+            void assign(uint32_t n)
+            {
+                sums.assign(static_cast<std::size_t>(n) + 1, 0);
+                top_step = 1;
+                while(top_step <= n / 2)
+                {
+                    top_step <<= 1;
+                }
+            }
+
+            uint32_t size() const
+            {
+                return sums.empty() ? 0 : static_cast<uint32_t>(sums.size() - 1);
+            }
+
+            //delta may be negative, as long as no position goes below zero
+            void add(uint32_t position, int64_t delta)
+            {
+                for(uint32_t i = position + 1; i < sums.size(); i += i & (0u - i))
+                {
+                    sums[i] += static_cast<uint64_t>(delta);
+                }
+            }
+
+            //sum of positions 0..position
+            uint64_t prefix(uint32_t position) const
+            {
+                uint64_t sum = 0;
+                for(uint32_t i = position + 1; i > 0; i -= i & (0u - i))
+                {
+                    sum += sums[i];
+                }
+                return sum;
+            }
+
+            //first position whose prefix() reaches target (target > 0), or size() if the whole tree holds less
+            uint32_t firstReaching(uint64_t target) const
+            {
+                uint32_t position = 0;
+                for(uint32_t step = top_step; step > 0; step >>= 1)
+                {
+                    if(position + step < sums.size() && sums[position + step] < target)
+                    {
+                        position += step;
+                        target -= sums[position];
+                    }
+                }
+                return position;
+            }
+    };
+}
+
+#endif
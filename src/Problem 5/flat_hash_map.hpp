@@ -103,6 +103,17 @@ struct KeyOrValueHasher : functor_storage<size_t, hasher>
     {
         return static_cast<const hasher_storage &>(*this)(value.first);
     }
+    // heterogeneous keys, only for hashers that declare is_transparent
+    template<typename K, typename H = hasher, typename = typename H::is_transparent>
+    size_t operator()(const K & key)
+    {
+        return static_cast<hasher_storage &>(*this)(key);
+    }
+    template<typename K, typename H = hasher, typename = typename H::is_transparent>
+    size_t operator()(const K & key) const
+    {
+        return static_cast<const hasher_storage &>(*this)(key);
+    }
 };
 template<typename key_type, typename value_type, typename key_equal>
 struct KeyOrValueEquality : functor_storage<bool, key_equal>
@@ -154,6 +165,12 @@ struct KeyOrValueEquality : functor_storage<bool, key_equal>
     {
         return static_cast<equality_storage &>(*this)(lhs.first, rhs.first);
     }
+    // heterogeneous keys, only for key_equals that declare is_transparent
+    template<typename K, typename E = key_equal, typename = typename E::is_transparent>
+    bool operator()(const K & lhs, const value_type & rhs)
+    {
+        return static_cast<equality_storage &>(*this)(lhs, rhs.first);
+    }
 };
 static constexpr int8_t min_lookups = 4;
 template<typename T>
@@ -276,6 +293,15 @@ struct HashPolicySelector<T, void_t<typename T::hash_policy>>
     typedef typename T::hash_policy type;
 };
 
+template<typename T, typename = void>
+struct IsTransparent : std::false_type
+{
+};
+template<typename T>
+struct IsTransparent<T, void_t<typename T::is_transparent>> : std::true_type
+{
+};
+
 template<typename T, typename FindKey, typename ArgumentHash, typename Hasher, typename ArgumentEqual, typename Equal, typename ArgumentAlloc, typename EntryAlloc>
 class sherwood_v3_table : private EntryAlloc, private Hasher, private Equal
 {
@@ -428,7 +454,9 @@ public:
     }
     ~sherwood_v3_table()
     {
-        clear();
+        // trivially destructible entries need no pass over the slots before the table is freed
+        if (!std::is_trivially_destructible<T>::value)
+            clear();
         deallocate_data(entries, num_slots_minus_one, max_lookups);
     }
 
@@ -556,6 +584,83 @@ public:
     {
         return find(key) == end() ? 0 : 1;
     }
+
+    // heterogeneous lookup: lets a transparent hasher/key_equal pair look up
+    // keys of another type (e.g. std::string_view) without building a FindKey
+    template<typename K>
+    using enable_if_transparent = typename std::enable_if<
+            IsTransparent<ArgumentHash>::value && IsTransparent<ArgumentEqual>::value
+            && !std::is_convertible<const K &, const_iterator>::value>::type;
+
+    template<typename K, typename = enable_if_transparent<K>>
+    iterator find(const K & key)
+    {
+        size_t index = hash_policy.index_for_hash(hash_object(key), num_slots_minus_one);
+        EntryPointer it = entries + ptrdiff_t(index);
+        for (int8_t distance = 0; it->distance_from_desired >= distance; ++distance, ++it)
+        {
+            if (compares_equal(key, it->value))
+                return { it };
+        }
+        return end();
+    }
+    template<typename K, typename = enable_if_transparent<K>>
+    const_iterator find(const K & key) const
+    {
+        return const_cast<sherwood_v3_table *>(this)->find(key);
+    }
+    template<typename K, typename = enable_if_transparent<K>>
+    size_t count(const K & key) const
+    {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    // precomputed-hash interface for batched callers: hash a run of keys up
+    // front, prefetch their home slots, then probe with the stored hashes so
+    // the cache misses of many lookups overlap
+    template<typename K>
+    size_t hash_key(const K & key) const
+    {
+        return hash_object(key);
+    }
+    void prefetch(size_t hash) const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(entries + ptrdiff_t(hash_policy.index_for_hash(hash, num_slots_minus_one)));
+#else
+        (void)hash;
+#endif
+    }
+    template<typename K>
+    iterator find_hashed(const K & key, size_t hash)
+    {
+        size_t index = hash_policy.index_for_hash(hash, num_slots_minus_one);
+        EntryPointer it = entries + ptrdiff_t(index);
+        for (int8_t distance = 0; it->distance_from_desired >= distance; ++distance, ++it)
+        {
+            if (compares_equal(key, it->value))
+                return { it };
+        }
+        return end();
+    }
+    template<typename K>
+    const_iterator find_hashed(const K & key, size_t hash) const
+    {
+        return const_cast<sherwood_v3_table *>(this)->find_hashed(key, hash);
+    }
+    template<typename Key, typename... Args>
+    std::pair<iterator, bool> emplace_hashed(size_t hash, Key && key, Args &&... args)
+    {
+        size_t index = hash_policy.index_for_hash(hash, num_slots_minus_one);
+        EntryPointer current_entry = entries + ptrdiff_t(index);
+        int8_t distance_from_desired = 0;
+        for (; current_entry->distance_from_desired >= distance_from_desired; ++current_entry, ++distance_from_desired)
+        {
+            if (compares_equal(key, current_entry->value))
+                return { { current_entry }, false };
+        }
+        return emplace_new_key(distance_from_desired, current_entry, std::forward<Key>(key), std::forward<Args>(args)...);
+    }
     std::pair<iterator, iterator> equal_range(const FindKey & key)
     {
         iterator found = find(key);
@@ -719,6 +824,18 @@ public:
             return 1;
         }
     }
+    template<typename K, typename = enable_if_transparent<K>>
+    size_t erase(const K & key)
+    {
+        auto found = find(key);
+        if (found == end())
+            return 0;
+        else
+        {
+            erase(found);
+            return 1;
+        }
+    }
 
     void clear()
     {
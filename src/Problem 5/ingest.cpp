@@ -0,0 +1,60 @@
+#include "auction_prices.h"
+#include "journal.h"
+#include "order_file.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+//ingest <orders.csv | journal> [threads] [snapshot_out]
+//Loads an order file into a fresh AuctionPrices, reports the rate, and optionally saves a snapshot of the result.
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr<<"usage: "<<argv[0]<<" <orders.csv | journal> [threads] [snapshot_out]"<<std::endl;
+        return 2;
+    }
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 0;
+
+    AP::AuctionPrices AuctionHouse;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    uint64_t orders = 0;
+    int status;
+
+    //journals carry a magic header; anything else is read as CSV
+    bool binary = false;
+    if(std::FILE* probe = std::fopen(argv[1], "rb"))
+    {
+        char magic[6] = {};
+        binary = std::fread(magic, sizeof(magic), 1, probe) == 1 && std::memcmp(magic, "APJRNL", sizeof(magic)) == 0;
+        std::fclose(probe);
+    }
+    if(binary)
+    {
+        status = AP::replayJournal(argv[1], AuctionHouse, &orders);
+    }
+    else
+    {
+        AP::ingest_stats stats;
+        status = AP::ingestOrderFile(argv[1], AuctionHouse, threads, &stats);
+        orders = stats.lines;
+        std::cout<<"accepted: "<<stats.accepted<<" rejected: "<<stats.rejected<<" malformed: "<<stats.malformed<<std::endl;
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    if(!status)
+    {
+        std::cerr<<"cannot read "<<argv[1]<<std::endl;
+        return 1;
+    }
+
+    double ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(endTime - startTime).count();
+    std::cout<<orders<<" orders in "<<ms<<" ms ("<<(ms > 0 ? orders / ms / 1000.0 : 0.0)<<" M orders/s)"<<std::endl;
+
+    if(argc > 3 && !AuctionHouse.saveSnapshot(argv[3]))
+    {
+        std::cerr<<"cannot write "<<argv[3]<<std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+#ifndef INLINEID_H_
+#define INLINEID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+namespace AP
+{
+    //Fixed-capacity ID stored inline (no heap allocation). Holds up to Capacity-1 characters, the last
+    //byte is the length, so inline_id<24> fits 23-character IDs and inline_id<32> fits 31-character IDs.
+    template<std::size_t Capacity>
+    class inline_id
+    {
+        static_assert(Capacity >= 2 && Capacity <= 256, "inline_id length must fit in its last byte");
+
+        private:
+            char chars[Capacity - 1];
+            uint8_t length;
+
+        public:
+            static constexpr std::size_t max_length = Capacity - 1;
+
+            inline_id()
+                : length(0)
+            {
+
+            }
+
+            //IDs longer than max_length must be rejected by the caller, see fits()
+            explicit inline_id(std::string_view id)
+                : length(static_cast<uint8_t>(id.size()))
+            {
+                std::memcpy(chars, id.data(), id.size());
+            }
+
+            static bool fits(std::string_view id)
+            {
+                return id.size() <= max_length;
+            }
+
+            std::string_view view() const
+            {
+                return std::string_view(chars, length);
+            }
+
+            std::size_t size() const
+            {
+                return length;
+            }
+    };
+
+    //ID of any length in Capacity bytes. Up to Capacity-1 characters are stored inline, as in inline_id; a
+    //longer ID is copied to the heap, and the inline bytes hold its pointer and length instead. Copies are deep,
+    //so a copy of a page of IDs (see cow_pool) shares nothing with the original. The heap copy never comes from
+    //a session arena, since a snapshot reader may destroy the page that holds the ID.
+    template<std::size_t Capacity>
+    class compact_id
+    {
+        static_assert(Capacity >= sizeof(char*) + sizeof(std::size_t) + 1 && Capacity <= 255,
+                      "compact_id must hold a heap pointer and length, and an inline length below its heap tag");
+
+        private:
+            static constexpr uint8_t on_heap = 0xFF;
+
+            //bytes, not a union with the pointer, so the ID stays 1-byte aligned and packs like inline_id
+            char chars[Capacity - 1];
+            uint8_t length;
+
+            char* heapData() const
+            {
+                char* data;
+                std::memcpy(&data, chars, sizeof(data));
+                return data;
+            }
+
+            std::size_t heapSize() const
+            {
+                std::size_t size;
+                std::memcpy(&size, chars + sizeof(char*), sizeof(size));
+                return size;
+            }
+
+            void assign(std::string_view id)
+            {
+                if(id.size() <= max_inline)
+                {
+                    std::memcpy(chars, id.data(), id.size());
+                    length = static_cast<uint8_t>(id.size());
+                    return;
+                }
+                char* data = new char[id.size()];
+                std::size_t size = id.size();
+                std::memcpy(data, id.data(), size);
+                std::memcpy(chars, &data, sizeof(data));
+                std::memcpy(chars + sizeof(data), &size, sizeof(size));
+                length = on_heap;
+            }
+
+            void take(compact_id& other)
+            {
+                std::memcpy(chars, other.chars, sizeof(chars));
+                length = other.length;
+                other.length = 0;
+            }
+
+            void release()
+            {
+                if(length == on_heap)
+                {
+                    delete[] heapData();
+                }
+            }
+
+        public:
+            static constexpr std::size_t max_inline = Capacity - 1;
+
+            compact_id()
+                : length(0)
+            {
+
+            }
+
+            explicit compact_id(std::string_view id)
+            {
+                assign(id);
+            }
+
+            compact_id(const compact_id& other)
+            {
+                assign(other.view());
+            }
+
+            compact_id(compact_id&& other) noexcept
+            {
+                take(other);
+            }
+
+            compact_id& operator=(const compact_id& other)
+            {
+                if(this != &other)
+                {
+                    release();
+                    assign(other.view());
+                }
+                return *this;
+            }
+
+            compact_id& operator=(compact_id&& other) noexcept
+            {
+                if(this != &other)
+                {
+                    release();
+                    take(other);
+                }
+                return *this;
+            }
+
+            ~compact_id()
+            {
+                release();
+            }
+
+            std::string_view view() const
+            {
+                return (length == on_heap) ? std::string_view(heapData(), heapSize()) : std::string_view(chars, length);
+            }
+
+            std::size_t size() const
+            {
+                return (length == on_heap) ? heapSize() : length;
+            }
+    };
+
+    typedef compact_id<32> order_id;
+
+    inline std::string_view idView(std::string_view id)
+    {
+        return id;
+    }
+
+    template<std::size_t Capacity>
+    std::string_view idView(const inline_id<Capacity>& id)
+    {
+        return id.view();
+    }
+
+    template<std::size_t Capacity>
+    std::string_view idView(const compact_id<Capacity>& id)
+    {
+        return id.view();
+    }
+
+    //Transparent hash/equality for ska::flat_hash_map, so maps keyed by inline_id, compact_id or std::string
+    //can be searched with a std::string_view (or const char*) without building a key first. Every key type
+    //hashes its characters the same way, so the hashes agree.
+    struct id_hash
+    {
+        typedef void is_transparent;
+
+        std::size_t operator()(std::string_view id) const
+        {
+            return std::hash<std::string_view>()(id);
+        }
+
+        template<std::size_t Capacity>
+        std::size_t operator()(const inline_id<Capacity>& id) const
+        {
+            return std::hash<std::string_view>()(id.view());
+        }
+
+        template<std::size_t Capacity>
+        std::size_t operator()(const compact_id<Capacity>& id) const
+        {
+            return std::hash<std::string_view>()(id.view());
+        }
+    };
+
+    struct id_equal
+    {
+        typedef void is_transparent;
+
+        template<typename L, typename R>
+        bool operator()(const L& lhs, const R& rhs) const
+        {
+            return idView(lhs) == idView(rhs);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef ITEMUNIVERSE_H_
+#define ITEMUNIVERSE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//Perfect hashing for a session whose item_IDs are known up front (README improvement #1).
+//Items are bucketed by one hash, and every bucket gets a seed (hash and displace) that sends each of
+//its items to a distinct slot. A lookup is one string hash, two array reads and one compare: no probing.
+//The table can be built at compile time (static_item_universe, from a constexpr list or a generated
+//header) or at session start (item_universe); both are used through item_universe_view.
+
+namespace AP
+{
+    constexpr uint32_t no_item = UINT32_MAX;
+
+    constexpr uint64_t itemHash(std::string_view item_ID)
+    {
+        //FNV-1a followed by the murmur3 finalizer
+        uint64_t hash = 14695981039346656037ULL;
+        for(char c: item_ID)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb3fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    constexpr uint64_t itemSlotHash(uint64_t hash, uint32_t seed)
+    {
+        hash ^= seed * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 31;
+        hash *= 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 29;
+        return hash;
+    }
+
+    //Non-owning view of a built table. Item i of the declared list maps to index i.
+    struct item_universe_view
+    {
+        const std::string_view* ids;
+        const uint32_t* seeds;
+        const uint32_t* slots;
+        uint32_t num_ids;
+        uint32_t num_buckets;
+        uint32_t num_slots;
+
+        constexpr uint32_t find(std::string_view item_ID) const
+        {
+            if(num_ids == 0)
+            {
+                return no_item;
+            }
+            uint64_t hash = itemHash(item_ID);
+            uint32_t item = slots[itemSlotHash(hash, seeds[hash % num_buckets]) % num_slots];
+            return (item != no_item && ids[item] == item_ID) ? item : no_item;
+        }
+
+        //true for a non-empty table that was built: every item_ID is found at its own index, so a view of a
+        //table whose build failed (valid() false on the table) is not valid either
+        constexpr bool valid() const
+        {
+            if(num_ids == 0 || ids == nullptr || seeds == nullptr || slots == nullptr || num_buckets == 0
+               || num_slots < num_ids)
+            {
+                return false;
+            }
+            for(uint32_t i = 0; i < num_ids; i++)
+            {
+                if(find(ids[i]) != i)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    //Fills seeds/slots for ids. order, bucket_start (num_buckets + 1) and hashes are scratch space.
+    //Returns false if no seed separates a bucket, which only happens for duplicate item_IDs.
+    constexpr bool buildItemUniverse(const std::string_view* ids, uint32_t num_ids,
+                                     uint32_t* seeds, uint32_t num_buckets, uint32_t* slots, uint32_t num_slots,
+                                     uint32_t* order, uint32_t* bucket_start, uint64_t* hashes)
+    {
+        for(uint32_t s = 0; s < num_slots; s++)
+        {
+            slots[s] = no_item;
+        }
+        for(uint32_t b = 0; b <= num_buckets; b++)
+        {
+            bucket_start[b] = 0;
+        }
+
+        //counting sort of the items by bucket
+        for(uint32_t i = 0; i < num_ids; i++)
+        {
+            hashes[i] = itemHash(ids[i]);
+            bucket_start[hashes[i] % num_buckets + 1]++;
+        }
+        uint32_t max_size = 0;
+        for(uint32_t b = 0; b < num_buckets; b++)
+        {
+            if(bucket_start[b + 1] > max_size)
+            {
+                max_size = bucket_start[b + 1];
+            }
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        for(uint32_t b = 0; b < num_buckets; b++)
+        {
+            seeds[b] = bucket_start[b];
+        }
+        for(uint32_t i = 0; i < num_ids; i++)
+        {
+            order[seeds[hashes[i] % num_buckets]++] = i;
+        }
+
+        //largest buckets first, while most slots are still free
+        for(uint32_t b = 0; b < num_buckets; b++)
+        {
+            seeds[b] = 0;
+        }
+        for(uint32_t size = max_size; size > 0; size--)
+        {
+            for(uint32_t b = 0; b < num_buckets; b++)
+            {
+                uint32_t first = bucket_start[b];
+                uint32_t last = bucket_start[b + 1];
+                if(last - first != size)
+                {
+                    continue;
+                }
+
+                bool placed = false;
+                for(uint32_t seed = 1; seed < (1u << 16) && !placed; seed++)
+                {
+                    placed = true;
+                    for(uint32_t k = first; k < last && placed; k++)
+                    {
+                        uint32_t slot = itemSlotHash(hashes[order[k]], seed) % num_slots;
+                        if(slots[slot] != no_item)
+                        {
+                            placed = false;
+                        }
+                        for(uint32_t j = first; j < k && placed; j++)
+                        {
+                            if(itemSlotHash(hashes[order[j]], seed) % num_slots == slot)
+                            {
+                                placed = false;
+                            }
+                        }
+                    }
+                    if(placed)
+                    {
+                        seeds[b] = seed;
+                        for(uint32_t k = first; k < last; k++)
+                        {
+                            slots[itemSlotHash(hashes[order[k]], seed) % num_slots] = order[k];
+                        }
+                    }
+                }
+                if(!placed)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    //Compile-time table:
+    //    static constexpr std::array<std::string_view, 2> items = {"item1", "item2"};
+    //    static constexpr AP::static_item_universe<2> universe(items);
+    //    static_assert(universe.valid(), "duplicate item_ID");
+    template<std::size_t N>
+    class static_item_universe
+    {
+        public:
+            static constexpr uint32_t num_buckets = N / 4 + 1;
+            static constexpr uint32_t num_slots = N + N / 4 + 1;
+
+        private:
+            std::array<std::string_view, N> ids;
+            std::array<uint32_t, num_buckets> seeds;
+            std::array<uint32_t, num_slots> slots;
+            bool built;
+
+        public:
+            constexpr explicit static_item_universe(const std::array<std::string_view, N>& item_IDs)
+                : ids(item_IDs), seeds(), slots(), built(false)
+            {
+                std::array<uint32_t, N> order = {};
+                std::array<uint32_t, num_buckets + 1> bucket_start = {};
+                std::array<uint64_t, N> hashes = {};
+                built = buildItemUniverse(ids.data(), N, seeds.data(), num_buckets, slots.data(), num_slots,
+                                          order.data(), bucket_start.data(), hashes.data());
+            }
+
+            constexpr bool valid() const
+            {
+                return built;
+            }
+
+            constexpr item_universe_view view() const
+            {
+                return {ids.data(), seeds.data(), slots.data(), static_cast<uint32_t>(N), num_buckets, num_slots};
+            }
+    };
+
+    //Table built at session start from a runtime list. Owns a copy of the item_IDs, so it is move-only:
+    //views keep pointing into the moved buffers.
+    class item_universe
+    {
+        private:
+            std::vector<char> chars;
+            std::vector<std::string_view> ids;
+            std::vector<uint32_t> seeds;
+            std::vector<uint32_t> slots;
+            bool built;
+
+        public:
+            explicit item_universe(const std::vector<std::string_view>& item_IDs);
+            item_universe(item_universe&&) = default;
+            item_universe& operator=(item_universe&&) = default;
+            item_universe(const item_universe&) = delete;
+            item_universe& operator=(const item_universe&) = delete;
+
+            bool valid() const
+            {
+                return built;
+            }
+
+            item_universe_view view() const
+            {
+                return {ids.data(), seeds.data(), slots.data(), static_cast<uint32_t>(ids.size()),
+                        static_cast<uint32_t>(seeds.size()), static_cast<uint32_t>(slots.size())};
+            }
+    };
+
+    inline item_universe::item_universe(const std::vector<std::string_view>& item_IDs)
+        : built(false)
+    {
+        size_t total = 0;
+        for(std::string_view id: item_IDs)
+        {
+            total += id.size();
+        }
+        chars.reserve(total);
+        for(std::string_view id: item_IDs)
+        {
+            chars.insert(chars.end(), id.begin(), id.end());
+        }
+        size_t offset = 0;
+        for(std::string_view id: item_IDs)
+        {
+            ids.push_back(std::string_view(chars.data() + offset, id.size()));
+            offset += id.size();
+        }
+
+        uint32_t num_ids = static_cast<uint32_t>(ids.size());
+        seeds.resize(num_ids / 4 + 1);
+        slots.resize(num_ids + num_ids / 4 + 1);
+        std::vector<uint32_t> order(num_ids);
+        std::vector<uint32_t> bucket_start(seeds.size() + 1);
+        std::vector<uint64_t> hashes(num_ids);
+        built = buildItemUniverse(ids.data(), num_ids, seeds.data(), static_cast<uint32_t>(seeds.size()),
+                                  slots.data(), static_cast<uint32_t>(slots.size()),
+                                  order.data(), bucket_start.data(), hashes.data());
+    }
+}
+
+#endif
@@ -0,0 +1,366 @@
+/*
+> Write-ahead journal: fixed-size records, written in groups, replayed from an mmap of the file.
+*/
+#include "journal.h"
+#include "auction_prices.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct journal_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+    };
+
+    const char journal_magic[8] = {'A', 'P', 'J', 'R', 'N', 'L', '\0', '\0'};
+    const uint32_t journal_version = 3;
+
+    //how many replayed records are handed to applyBatch() at once
+    const std::size_t replay_batch = 256;
+
+    uint32_t recordChecksum(const AP::journal_record& record)
+    {
+        uint32_t words[offsetof(AP::journal_record, checksum) / 4];
+        std::memcpy(words, &record, sizeof(words));
+        uint32_t hash = 2166136261u;
+        for(uint32_t word: words)
+        {
+            hash = (hash ^ word) * 16777619u;
+            hash ^= hash >> 15;
+        }
+        return hash;
+    }
+
+    bool validHeader(const AP::mapped_file& file)
+    {
+        if(file.size() < sizeof(journal_header))
+        {
+            return false;
+        }
+        journal_header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        return std::memcmp(header.magic, journal_magic, sizeof(journal_magic)) == 0
+               && header.version == journal_version && header.record_size == sizeof(AP::journal_record);
+    }
+
+    //number of intact records after the header, stopping at the first torn or corrupt one
+    uint64_t validRecords(const AP::mapped_file& file)
+    {
+        const AP::journal_record* records = reinterpret_cast<const AP::journal_record*>(file.data() + sizeof(journal_header));
+        uint64_t available = (file.size() - sizeof(journal_header)) / sizeof(AP::journal_record);
+        uint64_t count = 0;
+        while(count < available)
+        {
+            const AP::journal_record& record = records[count];
+            if(record.action < static_cast<uint8_t>(AP::order_action::add)
+               || record.action > static_cast<uint8_t>(AP::order_action::configure)
+               || record.item_length > AP::journal::max_id_length || record.auction_length > AP::journal::max_id_length
+               || record.checksum != recordChecksum(record))
+            {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    AP::journal_record makeRecord(AP::order_action action, std::string_view item_ID, std::string_view auction_ID)
+    {
+        //unused ID bytes stay zero, so equal records have equal checksums
+        AP::journal_record record = {};
+        record.action = static_cast<uint8_t>(action);
+        record.item_length = static_cast<uint8_t>(item_ID.size());
+        record.auction_length = static_cast<uint8_t>(auction_ID.size());
+        //an empty view may have a null data(), which memcpy must not be given
+        if(item_ID.size() != 0)
+        {
+            std::memcpy(record.item_ID, item_ID.data(), item_ID.size());
+        }
+        if(auction_ID.size() != 0)
+        {
+            std::memcpy(record.auction_ID, auction_ID.data(), auction_ID.size());
+        }
+        return record;
+    }
+}
+
+AP::journal::journal(uint32_t group_size, bool sync)
+    : file(nullptr), group_size(group_size ? group_size : 1), sync(sync)
+{
+    pending.reserve(this->group_size);
+}
+
+AP::journal::~journal()
+{
+    close();
+}
+
+int AP::journal::open(const char* path)
+{
+    close();
+
+    uint64_t keep = 0;
+    {
+        AP::mapped_file existing;
+        if(existing.open(path) && existing.size() > 0)
+        {
+            if(!validHeader(existing))
+            {
+                //not a journal (or another version): never append to it
+                return 0;
+            }
+            keep = sizeof(journal_header) + validRecords(existing) * sizeof(AP::journal_record);
+        }
+    }
+
+    if(keep == 0)
+    {
+        file = std::fopen(path, "wb");
+        if(file == nullptr)
+        {
+            return 0;
+        }
+        journal_header header;
+        std::memcpy(header.magic, journal_magic, sizeof(journal_magic));
+        header.version = journal_version;
+        header.record_size = sizeof(AP::journal_record);
+        if(std::fwrite(&header, sizeof(header), 1, file) != 1 || std::fflush(file) != 0)
+        {
+            close();
+            return 0;
+        }
+        return 1;
+    }
+
+    //drop a torn tail, so new records follow the last intact one
+#if defined(_WIN32)
+    file = std::fopen(path, "r+b");
+    if(file == nullptr || _chsize_s(_fileno(file), static_cast<long long>(keep)) != 0)
+    {
+        close();
+        return 0;
+    }
+    std::fseek(file, 0, SEEK_END);
+#else
+    if(truncate(path, static_cast<off_t>(keep)) != 0)
+    {
+        return 0;
+    }
+    file = std::fopen(path, "ab");
+    if(file == nullptr)
+    {
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+int AP::journal::close()
+{
+    if(file == nullptr)
+    {
+        return 1;
+    }
+    int commit_status = commit();
+    std::fclose(file);
+    file = nullptr;
+    return commit_status;
+}
+
+void AP::journal::append(const journal_record& record)
+{
+    pending.push_back(record);
+    pending.back().checksum = recordChecksum(pending.back());
+    if(pending.size() >= group_size)
+    {
+        commit();
+    }
+}
+
+void AP::journal::recordAdd(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity)
+{
+    journal_record record = makeRecord(AP::order_action::add, item_ID, auction_ID);
+    record.side = static_cast<int8_t>(side);
+    record.price = price;
+    record.quantity = quantity;
+    append(record);
+}
+
+void AP::journal::recordDelete(std::string_view item_ID, std::string_view auction_ID)
+{
+    append(makeRecord(AP::order_action::remove, item_ID, auction_ID));
+}
+
+void AP::journal::recordReduce(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity)
+{
+    journal_record record = makeRecord(AP::order_action::reduce, item_ID, auction_ID);
+    record.quantity = quantity;
+    append(record);
+}
+
+void AP::journal::recordAmend(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity)
+{
+    journal_record record = makeRecord(AP::order_action::amend, item_ID, auction_ID);
+    record.price = price;
+    record.quantity = quantity;
+    append(record);
+}
+
+void AP::journal::recordConfigure(std::string_view item_ID, int tick_size, int min_price, int max_price)
+{
+    journal_record record = makeRecord(AP::order_action::configure, item_ID, std::string_view());
+    record.price = tick_size;
+    record.min_price = min_price;
+    record.max_price = max_price;
+    append(record);
+}
+
+int AP::journal::commit()
+{
+    if(file == nullptr || pending.empty())
+    {
+        pending.clear();
+        return file != nullptr;
+    }
+    bool written = std::fwrite(pending.data(), sizeof(journal_record), pending.size(), file) == pending.size()
+                   && std::fflush(file) == 0;
+    pending.clear();
+    if(written && sync)
+    {
+#if defined(_WIN32)
+        written = _commit(_fileno(file)) == 0;
+#else
+        written = fdatasync(fileno(file)) == 0;
+#endif
+    }
+    return written ? 1 : 0;
+}
+
+int AP::replayJournal(const char* path, AP::AuctionPrices& prices, uint64_t* records)
+{
+    AP::mapped_file file;
+    if(!file.open(path))
+    {
+        return 0;
+    }
+    uint64_t count = 0;
+    const AP::journal_record* journal = nullptr;
+    if(file.size() > 0)
+    {
+        if(!validHeader(file))
+        {
+            return 0;
+        }
+        count = validRecords(file);
+        journal = reinterpret_cast<const AP::journal_record*>(file.data() + sizeof(journal_header));
+    }
+
+    //first pass: the most orders each item ever held at once, so every book is sized once up front. The
+    //resting quantity of every live order is tracked, so a repeated add of a live auction_ID and a reduction
+    //that takes all of an order count the way the books will apply them.
+    struct item_load
+    {
+        int64_t live;
+        int64_t peak;
+        bool configured;
+    };
+    ska::flat_hash_map<std::string_view, item_load, AP::id_hash, AP::id_equal> load;
+    //keyed by the record's item_ID and auction_ID fields, which are adjacent and zero-padded, so one view
+    //of both tells orders of different items apart
+    ska::flat_hash_map<std::string_view, uint32_t, AP::id_hash, AP::id_equal> resting;
+    for(uint64_t r = 0; r < count; r++)
+    {
+        const AP::journal_record& record = journal[r];
+        AP::order_action action = static_cast<AP::order_action>(record.action);
+        item_load& item = load[std::string_view(record.item_ID, record.item_length)];
+        if(action == AP::order_action::configure)
+        {
+            item.configured = true;
+            continue;
+        }
+        std::string_view order(record.item_ID, sizeof(record.item_ID) + record.auction_length);
+        if(action == AP::order_action::add)
+        {
+            if(resting.emplace(order, record.quantity).second)
+            {
+                item.peak = std::max(item.peak, ++item.live);
+            }
+            continue;
+        }
+        auto found = resting.find(order);
+        if(found == resting.end())
+        {
+            continue;
+        }
+        if(action == AP::order_action::remove || (action == AP::order_action::reduce && record.quantity >= found->second))
+        {
+            resting.erase(found);
+            item.live--;
+        }
+        else if(action == AP::order_action::reduce)
+        {
+            found->second -= record.quantity;
+        }
+        else if(record.quantity > 0)
+        {
+            found->second = record.quantity;
+        }
+    }
+    ska::flat_hash_map<std::string_view, uint32_t, AP::id_hash, AP::id_equal>().swap(resting);
+    //an item only ever named by removes or reductions gets no book, as it would not get one without a journal
+    for(auto& item: load)
+    {
+        if(item.second.peak > 0 || item.second.configured)
+        {
+            prices.reserveItem(item.first, static_cast<uint32_t>(item.second.peak));
+        }
+    }
+
+    //second pass: apply in batches; a configureItem record is applied in order, between two batches
+    std::vector<AP::order_op> ops;
+    ops.reserve(replay_batch);
+    for(uint64_t r = 0; r < count; r++)
+    {
+        const AP::journal_record& record = journal[r];
+        std::string_view item_ID(record.item_ID, record.item_length);
+        AP::order_action action = static_cast<AP::order_action>(record.action);
+        if(action == AP::order_action::configure)
+        {
+            prices.applyBatch(ops.data(), ops.size());
+            ops.clear();
+            prices.configureItem(item_ID, record.price, record.min_price, record.max_price);
+            continue;
+        }
+        AP::order_op op;
+        op.item_ID = item_ID;
+        op.auction_ID = std::string_view(record.auction_ID, record.auction_length);
+        op.action = action;
+        op.side = record.side;
+        op.price = record.price;
+        op.quantity = record.quantity;
+        ops.push_back(op);
+        if(ops.size() == replay_batch)
+        {
+            prices.applyBatch(ops.data(), ops.size());
+            ops.clear();
+        }
+    }
+    prices.applyBatch(ops.data(), ops.size());
+
+    if(records)
+    {
+        *records = count;
+    }
+    return 1;
+}
@@ -0,0 +1,83 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+namespace AP
+{
+    class AuctionPrices;
+
+    //One fixed-size journal record. IDs are stored inline (up to 31 characters each), so the journal can be
+    //replayed straight out of a mapping without parsing. Fields are in host byte order.
+    struct journal_record
+    {
+        uint8_t action;         //an AP::order_action, add to configure
+        int8_t side;
+        uint8_t item_length;
+        uint8_t auction_length;
+        int32_t price;          //tick_size for configureItem
+        union
+        {
+            int32_t min_price;  //configureItem
+            uint32_t quantity;  //addNewOrder, reduceOrder and amendOrder
+        };
+        int32_t max_price;      //configureItem only
+        char item_ID[32];
+        char auction_ID[32];
+        uint32_t checksum;      //of the bytes before it; a torn record at the tail fails the check
+    };
+    static_assert(sizeof(journal_record) == 84, "journal_record layout is part of the file format");
+
+    //Append-only write-ahead journal of the orders accepted by an AuctionPrices (see AuctionPrices::attachJournal()).
+    //Records are built in memory and written as a group: one write (and one fsync when sync is set) for
+    //every group_size records, or when commit() is called, so the per-order cost is a small memcpy.
+    //Records not yet committed are lost if the process dies.
+    class journal
+    {
+        private:
+            std::FILE* file;
+            std::vector<journal_record> pending;
+            uint32_t group_size;
+            bool sync;
+
+            void append(const journal_record& record);
+
+        public:
+            static constexpr std::size_t max_id_length = 31;
+
+            explicit journal(uint32_t group_size = 4096, bool sync = true);
+            ~journal();
+
+            journal(const journal&) = delete;
+            journal& operator=(const journal&) = delete;
+
+            //Creates the file, or reopens it for appending after dropping a torn tail. Returns 0 on failure.
+            int open(const char* path);
+            int close();
+
+            static bool fits(std::string_view id)
+            {
+                return id.size() <= max_id_length;
+            }
+
+            void recordAdd(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity = 1);
+            void recordDelete(std::string_view item_ID, std::string_view auction_ID);
+            void recordReduce(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity);
+            void recordAmend(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity);
+            void recordConfigure(std::string_view item_ID, int tick_size, int min_price, int max_price);
+
+            //writes (and syncs) the records of the current group
+            int commit();
+    };
+
+    //Rebuilds prices from a journal: mmaps the file, sizes every item's book from a first pass over the
+    //records, then applies them in batches. Replay stops at the first torn or corrupt record.
+    //records, if given, receives the number of records replayed. Returns 0 if the file cannot be read.
+    int replayJournal(const char* path, AP::AuctionPrices& prices, uint64_t* records = nullptr);
+}
+
+#endif
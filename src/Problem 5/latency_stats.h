@@ -0,0 +1,270 @@
+#ifndef LATENCYSTATS_H_
+#define LATENCYSTATS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define AP_LATENCY_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AP_LATENCY_RDTSC 1
+#endif
+
+//Latency instrumentation is compiled in only with -DAP_ENABLE_LATENCY_STATS (on every translation unit, since it
+//changes the layout of AuctionPrices). Without it the AP_LATENCY_* macros expand to nothing.
+#if defined(AP_ENABLE_LATENCY_STATS)
+#define AP_LATENCY_SCOPE(stats, op) AP::latency_scope latency_timer_((stats), (op))
+#define AP_LATENCY_CLASS(value) (latency_timer_.item_class = (value))
+#else
+#define AP_LATENCY_SCOPE(stats, op) ((void)0)
+#define AP_LATENCY_CLASS(value) ((void)0)
+#endif
+
+namespace AP
+{
+    //Each public call is timed once, under its own op. The exception is applyBatch() in matching mode, which
+    //applies its ops through the single-order calls: they are timed on their own as well as in the batch.
+    enum latency_op
+    {
+        latency_add,
+        latency_delete,
+        latency_reduce,     //reduceOrder()
+        latency_amend,      //amendOrder(), including the trades of an amend that crosses
+        latency_batch,      //one applyBatch() call
+        latency_top,        //bestBid()/bestOffer()
+        latency_print,      //one item of print()
+        latency_op_count
+    };
+
+    //items are classed by the layout of their book
+    enum latency_class
+    {
+        latency_hashed,
+        latency_tick,
+        latency_mixed,      //calls spanning several items (applyBatch())
+        latency_class_count
+    };
+
+    //time stamp counter (or steady_clock nanoseconds where there is none)
+    inline uint64_t latencyTicks()
+    {
+#if defined(AP_LATENCY_RDTSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    //measured once, over 10 ms, the first time it is needed
+    inline double ticksPerNanosecond()
+    {
+#if defined(AP_LATENCY_RDTSC)
+        static const double rate = []()
+        {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t first = latencyTicks();
+            while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10))
+            {
+
+            }
+            uint64_t last = latencyTicks();
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            return elapsed > 0 ? (last - first) / elapsed : 1.0;
+        }();
+        return rate;
+#else
+        return 1.0;
+#endif
+    }
+
+    //Log-linear buckets (as in HDR histograms): exact below 32 ticks, then 16 buckets per power of two,
+    //so every value is reported within 1/16 of itself. Values of 2^40 ticks and more share the last bucket.
+    struct latency_buckets
+    {
+        static constexpr int sub_bits = 4;
+        static constexpr int linear = 2 << sub_bits;
+        static constexpr int max_exponent = 40;
+        static constexpr int count = linear + (max_exponent - sub_bits - 1) * (1 << sub_bits);
+
+        static int index(uint64_t ticks)
+        {
+            if(ticks < static_cast<uint64_t>(linear))
+            {
+                return static_cast<int>(ticks);
+            }
+            int exponent = 63 - __builtin_clzll(ticks);
+            if(exponent >= max_exponent)
+            {
+                return count - 1;
+            }
+            return linear + (exponent - sub_bits - 1) * (1 << sub_bits)
+                   + static_cast<int>((ticks >> (exponent - sub_bits)) & ((1 << sub_bits) - 1));
+        }
+
+        //largest value that falls in bucket
+        static uint64_t highest(int bucket)
+        {
+            if(bucket < linear)
+            {
+                return static_cast<uint64_t>(bucket);
+            }
+            int exponent = (bucket - linear) / (1 << sub_bits) + sub_bits + 1;
+            uint64_t mantissa = (1 << sub_bits) + (bucket - linear) % (1 << sub_bits);
+            return ((mantissa + 1) << (exponent - sub_bits)) - 1;
+        }
+    };
+
+    //A copy of one histogram's counts, taken while it keeps recording
+    struct latency_counts
+    {
+        uint64_t counts[latency_buckets::count];
+        uint64_t max;
+
+        uint64_t total() const
+        {
+            uint64_t sum = 0;
+            for(uint64_t count: counts)
+            {
+                sum += count;
+            }
+            return sum;
+        }
+
+        //bound of the first bucket that at least a fraction q of the samples do not exceed (at most max)
+        uint64_t percentile(double q) const
+        {
+            uint64_t samples = total();
+            uint64_t rank = static_cast<uint64_t>(q * samples + 0.999999);
+            rank = rank ? rank : 1;
+            uint64_t seen = 0;
+            for(int bucket = 0; bucket < latency_buckets::count; bucket++)
+            {
+                seen += counts[bucket];
+                if(seen >= rank)
+                {
+                    return bucket == latency_buckets::count - 1 ? max : std::min(max, latency_buckets::highest(bucket));
+                }
+            }
+            return max;
+        }
+    };
+
+    //Histogram with a single writer (the thread that owns the AuctionPrices) and any number of readers.
+    //The writer only does relaxed loads and stores, so recording is a handful of plain instructions with
+    //no locked operation, and readers never stop it.
+    class latency_histogram
+    {
+        private:
+            std::atomic<uint64_t> counts[latency_buckets::count];
+            std::atomic<uint64_t> max;
+
+        public:
+            latency_histogram()
+                : max(0)
+            {
+                for(auto& count: counts)
+                {
+                    count.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            void record(uint64_t ticks)
+            {
+                std::atomic<uint64_t>& count = counts[latency_buckets::index(ticks)];
+                count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                if(ticks > max.load(std::memory_order_relaxed))
+                {
+                    max.store(ticks, std::memory_order_relaxed);
+                }
+            }
+
+            void read(latency_counts& copy) const
+            {
+                for(int bucket = 0; bucket < latency_buckets::count; bucket++)
+                {
+                    copy.counts[bucket] = counts[bucket].load(std::memory_order_relaxed);
+                }
+                copy.max = max.load(std::memory_order_relaxed);
+            }
+    };
+
+    //One histogram per operation and item class
+    class latency_stats
+    {
+        private:
+            latency_histogram histograms[latency_op_count][latency_class_count];
+
+        public:
+            void record(latency_op op, latency_class item_class, uint64_t ticks)
+            {
+                histograms[op][item_class].record(ticks);
+            }
+
+            void read(latency_op op, latency_class item_class, latency_counts& copy) const
+            {
+                histograms[op][item_class].read(copy);
+            }
+
+            //count, p50, p99, p99.9 and max in nanoseconds of every histogram with samples; safe to call
+            //from any thread while the book keeps running
+            void print(std::ostream& out = std::cout) const
+            {
+                static const char* op_names[latency_op_count] = {"add", "delete", "reduce", "amend", "batch", "top", "print"};
+                static const char* class_names[latency_class_count] = {"hashed", "tick", "mixed"};
+                double rate = ticksPerNanosecond();
+                latency_counts copy;
+                for(int op = 0; op < latency_op_count; op++)
+                {
+                    for(int item_class = 0; item_class < latency_class_count; item_class++)
+                    {
+                        histograms[op][item_class].read(copy);
+                        uint64_t samples = copy.total();
+                        if(samples == 0)
+                        {
+                            continue;
+                        }
+                        out<<op_names[op]<<" "<<class_names[item_class]<<": count "<<samples
+                           <<" p50 "<<static_cast<uint64_t>(copy.percentile(0.5) / rate)
+                           <<" p99 "<<static_cast<uint64_t>(copy.percentile(0.99) / rate)
+                           <<" p99.9 "<<static_cast<uint64_t>(copy.percentile(0.999) / rate)
+                           <<" max "<<static_cast<uint64_t>(copy.max / rate)<<" ns\n";
+                    }
+                }
+                out.flush();
+            }
+    };
+
+    //Times its scope into stats. item_class can be set once the item is known.
+    class latency_scope
+    {
+        private:
+            latency_stats& stats;
+            latency_op op;
+            uint64_t start;
+
+        public:
+            latency_class item_class;
+
+            latency_scope(latency_stats& stats, latency_op op)
+                : stats(stats), op(op), start(latencyTicks()), item_class(latency_hashed)
+            {
+
+            }
+
+            ~latency_scope()
+            {
+                stats.record(op, item_class, latencyTicks() - start);
+            }
+
+            latency_scope(const latency_scope&) = delete;
+            latency_scope& operator=(const latency_scope&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AP
+{
+    //Read-only view of a whole file. On POSIX systems the file is mmapped, so reading it sequentially goes
+    //straight from the page cache. Elsewhere the file is read into memory.
+    class mapped_file
+    {
+        private:
+            const char* bytes;
+            std::size_t length;
+#if defined(_WIN32)
+            std::vector<char> buffer;
+#endif
+
+        public:
+            mapped_file()
+                : bytes(nullptr), length(0)
+            {
+
+            }
+
+            ~mapped_file()
+            {
+                close();
+            }
+
+            mapped_file(const mapped_file&) = delete;
+            mapped_file& operator=(const mapped_file&) = delete;
+
+            //returns 0 if the file cannot be opened; an empty file maps to data() == nullptr, size() == 0
+            int open(const char* path);
+            void close();
+
+            const char* data() const
+            {
+                return bytes;
+            }
+
+            std::size_t size() const
+            {
+                return length;
+            }
+    };
+
+#if defined(_WIN32)
+    inline int mapped_file::open(const char* path)
+    {
+        close();
+        std::FILE* file = std::fopen(path, "rb");
+        if(file == nullptr)
+        {
+            return 0;
+        }
+        std::fseek(file, 0, SEEK_END);
+        long end = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        buffer.resize(end > 0 ? static_cast<std::size_t>(end) : 0);
+        std::size_t read = buffer.empty() ? 0 : std::fread(buffer.data(), 1, buffer.size(), file);
+        std::fclose(file);
+        if(read != buffer.size())
+        {
+            buffer.clear();
+            return 0;
+        }
+        bytes = buffer.empty() ? nullptr : buffer.data();
+        length = buffer.size();
+        return 1;
+    }
+
+    inline void mapped_file::close()
+    {
+        buffer.clear();
+        buffer.shrink_to_fit();
+        bytes = nullptr;
+        length = 0;
+    }
+#else
+    inline int mapped_file::open(const char* path)
+    {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0)
+        {
+            return 0;
+        }
+        struct stat info;
+        if(fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return 0;
+        }
+        if(info.st_size == 0)
+        {
+            ::close(fd);
+            return 1;
+        }
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+        {
+            return 0;
+        }
+        //the file is read front to back
+        madvise(mapping, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(mapping);
+        length = static_cast<std::size_t>(info.st_size);
+        return 1;
+    }
+
+    inline void mapped_file::close()
+    {
+        if(bytes)
+        {
+            munmap(const_cast<char*>(bytes), length);
+        }
+        bytes = nullptr;
+        length = 0;
+    }
+#endif
+}
+
+#endif
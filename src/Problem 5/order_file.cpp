@@ -0,0 +1,264 @@
+/*
+> CSV order files are parsed in parallel and applied in order: workers turn chunks of the mapping into order_ops
+while the calling thread applies the chunks that are already parsed.
+*/
+#include "order_file.h"
+#include "auction_prices.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AP_SSE2_SCAN 1
+#endif
+
+namespace
+{
+    //bytes of the file per chunk; a chunk ends at the first line break after it
+    const std::size_t chunk_bytes = std::size_t(1) << 22;
+
+    //parsed chunks waiting to be applied, per worker; bounds the memory held by order_ops
+    const std::size_t chunks_ahead = 4;
+
+    //how many ops are handed to applyBatch() at once
+    const std::size_t ingest_batch = 256;
+
+    struct file_chunk
+    {
+        const char* begin;
+        const char* end;
+        std::vector<AP::order_op> ops;
+        uint64_t lines;
+        uint64_t malformed;
+        bool parsed;
+    };
+
+    bool parseInt(std::string_view field, int& value)
+    {
+        const char* first = field.data();
+        const char* last = field.data() + field.size();
+        if(first != last && *first == '+')
+        {
+            first++;
+        }
+        auto result = std::from_chars(first, last, value);
+        return first != last && result.ec == std::errc() && result.ptr == last;
+    }
+
+    bool parseQuantity(std::string_view field, uint32_t& quantity)
+    {
+        auto result = std::from_chars(field.data(), field.data() + field.size(), quantity);
+        return !field.empty() && result.ec == std::errc() && result.ptr == field.data() + field.size() && quantity > 0;
+    }
+
+    //fields holds the first (up to) max_fields fields of one line, num_fields how many the line had
+    const int max_fields = 6;
+
+    void parseLine(std::string_view* fields, int num_fields, file_chunk& chunk)
+    {
+        std::string_view& last = fields[std::min(num_fields, max_fields) - 1];
+        if(!last.empty() && last.back() == '\r')
+        {
+            last.remove_suffix(1);
+        }
+        if(num_fields == 1 && fields[0].empty())
+        {
+            return;
+        }
+        chunk.lines++;
+
+        AP::order_op op = {};
+        std::string_view action = fields[0];
+        if(action == "A" || action == "add")
+        {
+            op.action = AP::order_action::add;
+        }
+        else if(action == "D" || action == "delete")
+        {
+            op.action = AP::order_action::remove;
+        }
+        else if(action == "R" || action == "reduce")
+        {
+            op.action = AP::order_action::reduce;
+        }
+        else if(action == "M" || action == "amend")
+        {
+            op.action = AP::order_action::amend;
+            op.quantity = 0;
+        }
+        int min_fields = (op.action == AP::order_action::add) ? 5 : (op.action == AP::order_action::remove) ? 3 : 4;
+        if(op.action == AP::order_action::none || num_fields < min_fields || fields[1].empty() || fields[2].empty()
+           || (op.action == AP::order_action::add && (!parseInt(fields[3], op.side) || !parseInt(fields[4], op.price)
+                                                      || (num_fields > 5 && !parseQuantity(fields[5], op.quantity))))
+           || (op.action == AP::order_action::reduce && !parseQuantity(fields[3], op.quantity))
+           || (op.action == AP::order_action::amend && (!parseInt(fields[3], op.price)
+                                                        || (num_fields > 4 && !parseQuantity(fields[4], op.quantity)))))
+        {
+            chunk.malformed++;
+            return;
+        }
+        op.item_ID = fields[1];
+        op.auction_ID = fields[2];
+        chunk.ops.push_back(op);
+    }
+
+    void parseChunk(file_chunk& chunk)
+    {
+        std::string_view fields[max_fields];
+        int num_fields = 0;
+        const char* field_start = chunk.begin;
+        auto delimiter = [&](const char* at)
+        {
+            if(num_fields < max_fields)
+            {
+                fields[num_fields] = std::string_view(field_start, static_cast<std::size_t>(at - field_start));
+            }
+            num_fields++;
+            field_start = at + 1;
+            if(at == chunk.end || *at == '\n')
+            {
+                parseLine(fields, num_fields, chunk);
+                num_fields = 0;
+            }
+        };
+
+        //most fields are a few bytes long, so delimiters are found 16 bytes at a time and visited bit by bit
+        const char* cursor = chunk.begin;
+#if defined(AP_SSE2_SCAN)
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i newline = _mm_set1_epi8('\n');
+        for(; chunk.end - cursor >= 16; cursor += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline))));
+            while(mask)
+            {
+                delimiter(cursor + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for(; cursor < chunk.end; cursor++)
+        {
+            if(*cursor == ',' || *cursor == '\n')
+            {
+                delimiter(cursor);
+            }
+        }
+        //a last line without a line break
+        if(num_fields > 0 || field_start < chunk.end)
+        {
+            delimiter(chunk.end);
+        }
+    }
+
+    //the first byte after the line break at or after from
+    const char* nextLine(const char* from, const char* end)
+    {
+        const void* line_break = std::memchr(from, '\n', static_cast<std::size_t>(end - from));
+        return line_break ? static_cast<const char*>(line_break) + 1 : end;
+    }
+}
+
+int AP::ingestOrderFile(const char* path, AP::AuctionPrices& prices, unsigned threads, AP::ingest_stats* stats)
+{
+    AP::mapped_file file;
+    if(!file.open(path))
+    {
+        return 0;
+    }
+    if(stats)
+    {
+        *stats = AP::ingest_stats();
+    }
+
+    std::vector<file_chunk> chunks;
+    const char* cursor = file.data();
+    const char* end = file.data() + file.size();
+    while(cursor < end)
+    {
+        const char* chunk_end = static_cast<std::size_t>(end - cursor) > chunk_bytes ? nextLine(cursor + chunk_bytes, end) : end;
+        chunks.push_back(file_chunk{cursor, chunk_end, {}, 0, 0, false});
+        cursor = chunk_end;
+    }
+    if(chunks.empty())
+    {
+        return 1;
+    }
+
+    if(threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunks.size()));
+    std::size_t window = threads * chunks_ahead;
+
+    //workers claim chunks in file order, but never more than window chunks past the one being applied
+    std::mutex lock;
+    std::condition_variable changed;
+    std::size_t next_chunk = 0;
+    std::size_t applied_chunks = 0;
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        while(true)
+        {
+            changed.wait(guard, [&]{ return next_chunk == chunks.size() || next_chunk < applied_chunks + window; });
+            if(next_chunk == chunks.size())
+            {
+                return;
+            }
+            file_chunk& chunk = chunks[next_chunk++];
+            guard.unlock();
+            //about one order per 24 bytes of CSV
+            chunk.ops.reserve(static_cast<std::size_t>(chunk.end - chunk.begin) / 24 + 1);
+            parseChunk(chunk);
+            guard.lock();
+            chunk.parsed = true;
+            changed.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for(unsigned i = 0; i < threads; i++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    for(file_chunk& chunk: chunks)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [&]{ return chunk.parsed; });
+        }
+        uint64_t accepted = 0;
+        for(std::size_t first = 0; first < chunk.ops.size(); first += ingest_batch)
+        {
+            accepted += prices.applyBatch(&chunk.ops[first], std::min(ingest_batch, chunk.ops.size() - first));
+        }
+        if(stats)
+        {
+            stats->lines += chunk.lines;
+            stats->accepted += accepted;
+            stats->rejected += chunk.ops.size() - accepted;
+            stats->malformed += chunk.malformed;
+        }
+        std::vector<AP::order_op>().swap(chunk.ops);
+
+        std::lock_guard<std::mutex> guard(lock);
+        applied_chunks++;
+        changed.notify_all();
+    }
+
+    for(std::thread& thread: workers)
+    {
+        thread.join();
+    }
+    return 1;
+}
@@ -0,0 +1,34 @@
+#ifndef ORDERFILE_H_
+#define ORDERFILE_H_
+
+#include <cstdint>
+
+namespace AP
+{
+    class AuctionPrices;
+
+    struct ingest_stats
+    {
+        uint64_t lines;         //non-empty lines read
+        uint64_t accepted;      //orders the books accepted
+        uint64_t rejected;      //well-formed orders the books refused (unknown auction_ID, off-tick price, ...)
+        uint64_t malformed;     //lines that could not be parsed
+    };
+
+    //Streams a CSV order file into prices. One order per line:
+    //    A,item_ID,auction_ID,side,price[,quantity]
+    //    D,item_ID,auction_ID
+    //    R,item_ID,auction_ID,quantity
+    //    M,item_ID,auction_ID,price[,quantity]
+    //(add/delete/reduce/amend are accepted for A/D/R/M; an add without a quantity is for 1, an amend without
+    //one keeps the order's quantity; trailing fields of a delete or reduce are ignored.)
+    //The file is mmapped and split into chunks at line boundaries. threads workers (0 = one per hardware
+    //thread) parse chunks in parallel, scanning for delimiters 16 bytes at a time, into order_ops whose fields
+    //point straight into the mapping. The calling thread applies the chunks in file order through applyBatch(),
+    //so the result is the same as applying the lines one by one.
+    //Binary order files are journals: use replayJournal() for those.
+    //Returns 0 if the file cannot be read.
+    int ingestOrderFile(const char* path, AP::AuctionPrices& prices, unsigned threads = 0, AP::ingest_stats* stats = nullptr);
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef OUTPUTSINK_H_
+#define OUTPUTSINK_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace AP
+{
+    //Buffered text output for print(). Text is formatted into one preallocated buffer (integers with
+    //std::to_chars) and handed over in a single write() per flush: to a file descriptor (stdout by default),
+    //a file opened by the sink, or appended to a caller-owned std::string.
+    //A failed write is remembered, and every later flush() returns 0.
+    class output_sink
+    {
+        private:
+            std::vector<char> buffer;
+            std::size_t used;
+            int fd;
+            bool owns_fd;
+            std::string* target;
+            bool failed;
+
+            bool writeAll(const char* data, std::size_t bytes)
+            {
+                if(target)
+                {
+                    target->append(data, bytes);
+                    return true;
+                }
+                if(fd < 0)
+                {
+                    return false;
+                }
+                if(fd == 1)
+                {
+                    //anything already sent through std::cout or stdio goes first
+                    std::cout.flush();
+                    std::fflush(stdout);
+                }
+                while(bytes > 0)
+                {
+#if defined(_WIN32)
+                    int written = _write(fd, data, static_cast<unsigned>(bytes > (1u << 30) ? (1u << 30) : bytes));
+#else
+                    ssize_t written = ::write(fd, data, bytes);
+#endif
+                    if(written < 0)
+                    {
+#if !defined(_WIN32)
+                        if(errno == EINTR)
+                        {
+                            continue;
+                        }
+#endif
+                        return false;
+                    }
+                    data += written;
+                    bytes -= static_cast<std::size_t>(written);
+                }
+                return true;
+            }
+
+            void reserve(std::size_t bytes)
+            {
+                if(used + bytes > buffer.size())
+                {
+                    flush();
+                }
+            }
+
+        public:
+            static constexpr std::size_t default_capacity = std::size_t(1) << 20;
+            //smaller capacities are raised to this, so a formatted integer (at most 11 characters) always fits
+            static constexpr std::size_t min_capacity = 64;
+
+            //writes to an open file descriptor (1 = stdout), which stays open
+            explicit output_sink(int fd = 1, std::size_t capacity = default_capacity)
+                : buffer(std::max(capacity, min_capacity)), used(0), fd(fd), owns_fd(false), target(nullptr), failed(false)
+            {
+
+            }
+
+            //appends to target, which must outlive the sink
+            explicit output_sink(std::string& target, std::size_t capacity = default_capacity)
+                : buffer(std::max(capacity, min_capacity)), used(0), fd(-1), owns_fd(false), target(&target), failed(false)
+            {
+
+            }
+
+            ~output_sink()
+            {
+                close();
+            }
+
+            output_sink(const output_sink&) = delete;
+            output_sink& operator=(const output_sink&) = delete;
+
+            //Flushes, then redirects the sink to a new file at path. Returns 0 if it cannot be created.
+            int open(const char* path)
+            {
+                close();
+#if defined(_WIN32)
+                fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+                fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+                owns_fd = fd >= 0;
+                target = nullptr;
+                failed = fd < 0;
+                return owns_fd ? 1 : 0;
+            }
+
+            //flushes, and closes a file opened by open()
+            int close()
+            {
+                int flush_status = flush();
+                if(owns_fd)
+                {
+#if defined(_WIN32)
+                    _close(fd);
+#else
+                    ::close(fd);
+#endif
+                    owns_fd = false;
+                    fd = -1;
+                }
+                return flush_status;
+            }
+
+            int flush()
+            {
+                if(used > 0 && !failed)
+                {
+                    failed = !writeAll(buffer.data(), used);
+                }
+                used = 0;
+                return failed ? 0 : 1;
+            }
+
+            bool good() const
+            {
+                return !failed;
+            }
+
+            output_sink& put(char c)
+            {
+                reserve(1);
+                buffer[used++] = c;
+                return *this;
+            }
+
+            output_sink& put(std::string_view text)
+            {
+                reserve(text.size());
+                if(text.size() > buffer.size())
+                {
+                    //longer than the whole buffer: goes out on its own
+                    failed = failed || !writeAll(text.data(), text.size());
+                    return *this;
+                }
+                text.copy(buffer.data() + used, text.size());
+                used += text.size();
+                return *this;
+            }
+
+            output_sink& put(int value)
+            {
+                reserve(12);
+                used = static_cast<std::size_t>(std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data());
+                return *this;
+            }
+
+            //"auction_ID price\n", the line print() writes for every order
+            output_sink& order(std::string_view auction_ID, int price)
+            {
+                return put(auction_ID).put(' ').put(price).put('\n');
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,294 @@
+/*
+> Items are independent, so the sharded front-end gives every shard its own AuctionPrices, arena and worker thread.
+The only state shared between threads is each shard's queue, its applied counter and its published snapshot.
+*/
+#include "sharded_auction_prices.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+//how many queued orders a worker hands to applyBatch() at once
+static const std::size_t worker_batch = 256;
+
+AP::ShardedAuctionPrices::shard::shard(std::size_t queue_capacity)
+    : prices(&memory), queue(queue_capacity), pushed(0), snapshots(0), applied(0), rejected(0)
+{
+
+}
+
+AP::ShardedAuctionPrices::ShardedAuctionPrices(uint32_t num_shards, std::size_t queue_capacity, bool pin_threads)
+    : stopping(false), snapshot_requests(0)
+{
+    uint32_t cores = std::thread::hardware_concurrency();
+    if(cores == 0)
+    {
+        cores = 1;
+    }
+    if(num_shards == 0)
+    {
+        num_shards = cores;
+    }
+
+    shards.reserve(num_shards);
+    for(uint32_t i = 0; i < num_shards; i++)
+    {
+        shards.emplace_back(new shard(queue_capacity));
+    }
+    for(uint32_t i = 0; i < num_shards; i++)
+    {
+        shard& target = *shards[i];
+        target.worker = std::thread(&AP::ShardedAuctionPrices::run, this, std::ref(target), i % cores, pin_threads);
+    }
+}
+
+AP::ShardedAuctionPrices::~ShardedAuctionPrices()
+{
+    //workers drain their queues before they exit
+    stopping.store(true, std::memory_order_release);
+    for(auto& target: shards)
+    {
+        target->worker.join();
+    }
+}
+
+void AP::ShardedAuctionPrices::run(shard& target, uint32_t core, bool pin)
+{
+    if(pin)
+    {
+#if defined(__linux__)
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(core, &cores);
+        pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#elif defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core);
+#else
+        (void)core;
+#endif
+    }
+
+    std::vector<AP::order_op> ops(worker_batch);
+    while(true)
+    {
+        std::size_t n = target.queue.readable(worker_batch);
+        if(n == 0)
+        {
+            //stopping is only set after the last push, so an empty queue seen after it is final
+            if(stopping.load(std::memory_order_acquire) && target.queue.readable(1) == 0)
+            {
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        if(target.queue.at(0).action == AP::order_action::compact)
+        {
+            target.prices.compact();
+            target.queue.pop(1);
+            target.applied.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+        if(target.queue.at(0).action == AP::order_action::snapshot)
+        {
+            target.prices.publishSnapshot(++target.snapshots);
+            target.queue.pop(1);
+            target.applied.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+
+        //the ops point at the IDs inside the queue entries, which stay put until pop()
+        for(std::size_t i = 0; i < n; i++)
+        {
+            const queued_op& entry = target.queue.at(i);
+            if(entry.action == AP::order_action::snapshot || entry.action == AP::order_action::compact)
+            {
+                //apply the orders before the snapshot or compaction request first
+                n = i;
+                break;
+            }
+            AP::order_op& op = ops[i];
+            op.item_ID = entry.item_ID.view();
+            op.auction_ID = entry.auction_ID.view();
+            op.action = entry.action;
+            op.side = entry.side;
+            op.price = entry.price;
+            op.quantity = entry.quantity;
+        }
+        int accepted = target.prices.applyBatch(ops.data(), n);
+        target.queue.pop(n);
+
+        target.rejected.fetch_add(n - accepted, std::memory_order_relaxed);
+        target.applied.fetch_add(n, std::memory_order_release);
+    }
+}
+
+AP::ShardedAuctionPrices::shard& AP::ShardedAuctionPrices::shardFor(std::string_view item_ID)
+{
+    return *shards[AP::itemHash(item_ID) % shards.size()];
+}
+
+int AP::ShardedAuctionPrices::push(shard& target, const queued_op& op)
+{
+    //a full queue means the worker is behind: wait for it rather than drop the order
+    while(!target.queue.push(op))
+    {
+        std::this_thread::yield();
+    }
+    target.pushed++;
+    return 1;
+}
+
+void AP::ShardedAuctionPrices::waitIdle(shard& target)
+{
+    //the acquire pairs with the worker's release, so everything it applied is visible afterwards
+    while(target.applied.load(std::memory_order_acquire) != target.pushed)
+    {
+        std::this_thread::yield();
+    }
+}
+
+int AP::ShardedAuctionPrices::addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price)
+{
+    return addNewOrder(item_ID, auction_ID, side, price, 1);
+}
+
+int AP::ShardedAuctionPrices::addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity)
+{
+    if(!queued_id::fits(item_ID) || !queued_id::fits(auction_ID))
+    {
+        return 0;
+    }
+    queued_op op = {queued_id(item_ID), queued_id(auction_ID), AP::order_action::add, side, price, quantity};
+    return push(shardFor(item_ID), op);
+}
+
+int AP::ShardedAuctionPrices::deleteOrder(std::string_view item_ID, std::string_view auction_ID)
+{
+    if(!queued_id::fits(item_ID) || !queued_id::fits(auction_ID))
+    {
+        return 0;
+    }
+    queued_op op = {queued_id(item_ID), queued_id(auction_ID), AP::order_action::remove, 0, 0, 0};
+    return push(shardFor(item_ID), op);
+}
+
+int AP::ShardedAuctionPrices::reduceOrder(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity)
+{
+    if(!queued_id::fits(item_ID) || !queued_id::fits(auction_ID))
+    {
+        return 0;
+    }
+    queued_op op = {queued_id(item_ID), queued_id(auction_ID), AP::order_action::reduce, 0, 0, quantity};
+    return push(shardFor(item_ID), op);
+}
+
+int AP::ShardedAuctionPrices::amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity)
+{
+    if(!queued_id::fits(item_ID) || !queued_id::fits(auction_ID))
+    {
+        return 0;
+    }
+    queued_op op = {queued_id(item_ID), queued_id(auction_ID), AP::order_action::amend, 0, price, quantity};
+    return push(shardFor(item_ID), op);
+}
+
+void AP::ShardedAuctionPrices::flush()
+{
+    for(auto& target: shards)
+    {
+        waitIdle(*target);
+    }
+}
+
+//A worker only touches its AuctionPrices while its queue is non-empty, and only this thread pushes, so once
+//the shard is idle its AuctionPrices can be used directly until the next push.
+
+int AP::ShardedAuctionPrices::configureItem(std::string_view item_ID, int tick_size, int min_price, int max_price)
+{
+    shard& target = shardFor(item_ID);
+    waitIdle(target);
+    return target.prices.configureItem(item_ID, tick_size, min_price, max_price);
+}
+
+int AP::ShardedAuctionPrices::bestBid(std::string_view item_ID, int& price)
+{
+    shard& target = shardFor(item_ID);
+    waitIdle(target);
+    return target.prices.bestBid(item_ID, price);
+}
+
+int AP::ShardedAuctionPrices::bestOffer(std::string_view item_ID, int& price)
+{
+    shard& target = shardFor(item_ID);
+    waitIdle(target);
+    return target.prices.bestOffer(item_ID, price);
+}
+
+uint64_t AP::ShardedAuctionPrices::rejectedOrders()
+{
+    flush();
+    uint64_t total = 0;
+    for(auto& target: shards)
+    {
+        total += target->rejected.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int AP::ShardedAuctionPrices::print()
+{
+    AP::output_sink out;
+    return print(out) && out.flush();
+}
+
+int AP::ShardedAuctionPrices::print(AP::output_sink& out)
+{
+    flush();
+    for(auto& target: shards)
+    {
+        if(target->prices.print(out) == 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint64_t AP::ShardedAuctionPrices::requestSnapshot()
+{
+    queued_op op = {queued_id(), queued_id(), AP::order_action::snapshot, 0, 0, 0};
+    for(auto& target: shards)
+    {
+        push(*target, op);
+    }
+    return ++snapshot_requests;
+}
+
+std::shared_ptr<const AP::house_snapshot> AP::ShardedAuctionPrices::latestSnapshot(uint32_t shard_index) const
+{
+    return shards[shard_index]->prices.latestSnapshot();
+}
+
+void AP::ShardedAuctionPrices::compact()
+{
+    queued_op op = {queued_id(), queued_id(), AP::order_action::compact, 0, 0, 0};
+    for(auto& target: shards)
+    {
+        push(*target, op);
+    }
+}
+
+const AP::latency_stats* AP::ShardedAuctionPrices::latencyStats(uint32_t shard_index) const
+{
+    return shards[shard_index]->prices.latencyStats();
+}
+
+uint32_t AP::ShardedAuctionPrices::shardCount() const
+{
+    return static_cast<uint32_t>(shards.size());
+}
@@ -0,0 +1,114 @@
+#ifndef SHARDEDAUCTIONPRICES_H_
+#define SHARDEDAUCTIONPRICES_H_
+
+#include "arena.h"
+#include "auction_prices.h"
+#include "inline_id.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace AP
+{
+    //Multi-threaded front-end. Items are partitioned by hash across shards, and every shard is an AuctionPrices
+    //(with its own arena) owned by one worker thread, optionally pinned to a core. The caller's thread is the
+    //single producer: addNewOrder()/deleteOrder() copy the order into the shard's queue and return, and the
+    //worker applies what it finds there in batches through AuctionPrices::applyBatch(). All orders of an item
+    //go through the same queue in arrival order, so per-item ordering is preserved.
+    //All member functions must be called from the same thread.
+    class ShardedAuctionPrices
+    {
+        private:
+            //item_IDs and auction_IDs are copied inline into the queue, so the caller's strings may go away
+            //as soon as a call returns
+            typedef AP::inline_id<32> queued_id;
+
+            //action is add, remove, reduce, amend, snapshot or compact
+            struct queued_op
+            {
+                queued_id item_ID;
+                queued_id auction_ID;
+                AP::order_action action;
+                int side;
+                int price;
+                uint32_t quantity;
+            };
+
+            struct shard
+            {
+                AP::arena memory;
+                AP::AuctionPrices prices;
+                AP::spsc_queue<queued_op> queue;
+
+                //ops pushed by the producer, snapshots published by the worker, and ops applied (or rejected)
+                //by the worker
+                uint64_t pushed;
+                uint64_t snapshots;
+                alignas(64) std::atomic<uint64_t> applied;
+                std::atomic<uint64_t> rejected;
+
+                std::thread worker;
+
+                explicit shard(std::size_t queue_capacity);
+            };
+
+            std::vector<std::unique_ptr<shard>> shards;
+            std::atomic<bool> stopping;
+            uint64_t snapshot_requests;
+
+            shard& shardFor(std::string_view item_ID);
+            int push(shard& target, const queued_op& op);
+            void waitIdle(shard& target);
+            void run(shard& target, uint32_t core, bool pin);
+
+        public:
+            //num_shards == 0 uses one shard per hardware thread
+            explicit ShardedAuctionPrices(uint32_t num_shards = 0, std::size_t queue_capacity = 1 << 16, bool pin_threads = true);
+            ~ShardedAuctionPrices();
+
+            ShardedAuctionPrices(const ShardedAuctionPrices&) = delete;
+            ShardedAuctionPrices& operator=(const ShardedAuctionPrices&) = delete;
+
+            //Queue an order, a delete, a reduction or an amend for its item's shard. Returns 0 only if an ID does not
+            //fit the queue entry (31 characters); whether the book accepted it is counted in rejectedOrders().
+            //The ops are applied later on the worker, so there are no order handles here.
+            int addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price);
+            int addNewOrder(std::string_view item_ID, std::string_view auction_ID, int side, int price, uint32_t quantity);
+            int deleteOrder(std::string_view item_ID, std::string_view auction_ID);
+            int reduceOrder(std::string_view item_ID, std::string_view auction_ID, uint32_t quantity);
+            int amendOrder(std::string_view item_ID, std::string_view auction_ID, int price, uint32_t quantity = 0);
+
+            //Waits until every queued order has been applied. The functions below flush first, so their
+            //results include everything queued before the call.
+            void flush();
+
+            int configureItem(std::string_view item_ID, int tick_size, int min_price, int max_price);
+            int bestBid(std::string_view item_ID, int& price);
+            int bestOffer(std::string_view item_ID, int& price);
+            uint64_t rejectedOrders();
+            int print();
+            int print(AP::output_sink& out);
+
+            //Queues a snapshot request behind everything queued so far. Each worker publishes its shard when it
+            //gets there, so the shard snapshots numbered with the returned sequence form one consistent cut of
+            //the order stream. Ingestion does not wait for it.
+            uint64_t requestSnapshot();
+            //Safe to call from any thread. Returns nullptr until the shard published its first snapshot.
+            std::shared_ptr<const AP::house_snapshot> latestSnapshot(uint32_t shard_index) const;
+            //Latency histograms of a shard's AuctionPrices (nullptr unless built with AP_ENABLE_LATENCY_STATS).
+            //Safe to read from any thread while the worker runs.
+            const AP::latency_stats* latencyStats(uint32_t shard_index) const;
+
+            //Queues a compaction pass (AuctionPrices::compact()) behind everything queued so far. Each worker
+            //runs it on its own shard when it gets there; ingestion does not wait for it.
+            void compact();
+
+            uint32_t shardCount() const;
+    };
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+> Snapshot files hold only the live orders of every book, already in priority order, so a restart loads them
+with one sequential pass and no rehashing instead of replaying the whole journal.
+*/
+#include "auction_prices.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //Layout (host byte order, every part starts on an 8-byte boundary):
+    //    snapshot_header
+    //    per item: item_header, item_ID (padded), snapshot_order[num_orders], string table (padded)
+    //Orders are stored bids first then offers, best price first and in arrival order within a price,
+    //so loading them in file order rebuilds the same FIFO queues.
+    struct snapshot_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t num_items;
+        uint64_t num_orders;
+    };
+
+    struct item_header
+    {
+        uint32_t item_length;
+        uint32_t num_orders;
+        uint32_t num_bids;      //the first num_bids orders are bids, the rest offers
+        uint32_t string_bytes;
+        int32_t tick_size;      //0 for the hashed layout
+        int32_t min_price;
+        int32_t max_price;
+        uint32_t reserved;
+    };
+
+    //auction_ID is string_bytes[id_offset, id_offset + id_length) of the item's string table.
+    struct snapshot_order
+    {
+        uint32_t id_offset;
+        uint32_t id_length;
+        int32_t price;
+        uint32_t quantity;
+    };
+
+    static_assert(sizeof(snapshot_header) == 24 && sizeof(item_header) == 32 && sizeof(snapshot_order) == 16,
+                  "snapshot layout is part of the file format");
+
+    const char snapshot_magic[8] = {'A', 'P', 'S', 'N', 'A', 'P', '\0', '\0'};
+    const uint32_t snapshot_version = 3;
+
+    std::size_t padded(std::size_t bytes)
+    {
+        return (bytes + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    bool writePadded(std::FILE* file, const void* data, std::size_t bytes)
+    {
+        static const char zeros[8] = {};
+        return (bytes == 0 || std::fwrite(data, bytes, 1, file) == 1)
+               && (padded(bytes) == bytes || std::fwrite(zeros, padded(bytes) - bytes, 1, file) == 1);
+    }
+}
+
+int AP::AuctionPrices::saveSnapshot(const char* path) const
+{
+    return saveSnapshot(snapshot(), path);
+}
+
+int AP::AuctionPrices::saveSnapshot(const AP::house_snapshot& house, const char* path)
+{
+    snapshot_header header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = snapshot_version;
+    header.num_items = 0;
+    header.num_orders = 0;
+    for(auto& book: house.books)
+    {
+        int tick_size, min_price, max_price;
+        if(!book.second.empty() || book.second.tickLayout(tick_size, min_price, max_price))
+        {
+            header.num_items++;
+            header.num_orders += book.second.size();
+        }
+    }
+
+    //written next to the target and renamed over it, so a crash never leaves a half-written snapshot behind
+    std::string temporary = std::string(path) + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if(file == nullptr)
+    {
+        return 0;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    bool written = writePadded(file, &header, sizeof(header));
+
+    std::vector<snapshot_order> orders;
+    std::string strings;
+    for(auto& book: house.books)
+    {
+        item_header item = {};
+        bool tick_book = book.second.tickLayout(item.tick_size, item.min_price, item.max_price);
+        if(!written || (book.second.empty() && !tick_book))
+        {
+            continue;
+        }
+
+        orders.clear();
+        strings.clear();
+        book.second.forEachOrder([&](std::string_view auction_ID, int side, int price, uint32_t quantity)
+        {
+            snapshot_order order = {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(auction_ID.size()),
+                                    price, quantity};
+            orders.push_back(order);
+            item.num_bids += (side == 1);
+            strings.append(auction_ID.data(), auction_ID.size());
+        });
+
+        item.item_length = static_cast<uint32_t>(book.first.size());
+        item.num_orders = static_cast<uint32_t>(orders.size());
+        item.string_bytes = static_cast<uint32_t>(strings.size());
+        written = writePadded(file, &item, sizeof(item))
+                  && writePadded(file, book.first.data(), book.first.size())
+                  && writePadded(file, orders.data(), orders.size() * sizeof(snapshot_order))
+                  && writePadded(file, strings.data(), strings.size());
+    }
+
+    written = written && std::fflush(file) == 0;
+#if defined(_WIN32)
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = (std::fclose(file) == 0) && written;
+    if(!written)
+    {
+        std::remove(temporary.c_str());
+        return 0;
+    }
+#if defined(_WIN32)
+    std::remove(path);
+#endif
+    return std::rename(temporary.c_str(), path) == 0 ? 1 : 0;
+}
+
+int AP::AuctionPrices::loadSnapshot(const char* path)
+{
+    for(auto& book: books)
+    {
+        if(!book.empty())
+        {
+            return 0;
+        }
+    }
+
+    AP::mapped_file file;
+    if(!file.open(path) || file.size() < sizeof(snapshot_header))
+    {
+        return 0;
+    }
+    snapshot_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 || header.version != snapshot_version)
+    {
+        return 0;
+    }
+
+    //table sizes come from the file, so nothing below rehashes or regrows
+    if(!universe.num_ids)
+    {
+        Library.reserve(Library.size() + header.num_items);
+        books.reserve(books.size() + header.num_items);
+        item_names.reserve(item_names.size() + header.num_items);
+    }
+
+    const char* cursor = file.data() + sizeof(header);
+    const char* end = file.data() + file.size();
+    for(uint32_t i = 0; i < header.num_items; i++)
+    {
+        item_header item;
+        if(static_cast<std::size_t>(end - cursor) < sizeof(item))
+        {
+            return 0;
+        }
+        std::memcpy(&item, cursor, sizeof(item));
+        cursor += sizeof(item);
+
+        std::size_t name_bytes = padded(item.item_length);
+        if(item.num_bids > item.num_orders)
+        {
+            return 0;
+        }
+        std::size_t order_bytes = padded(static_cast<std::size_t>(item.num_orders) * sizeof(snapshot_order));
+        std::size_t string_bytes = padded(item.string_bytes);
+        if(static_cast<std::size_t>(end - cursor) < name_bytes + order_bytes + string_bytes)
+        {
+            return 0;
+        }
+        std::string_view item_ID(cursor, item.item_length);
+        const char* orders = cursor + name_bytes;
+        const char* strings = cursor + name_bytes + order_bytes;
+        cursor += name_bytes + order_bytes + string_bytes;
+
+        uint32_t book_index;
+        AP::orderbook* book = bookFor(item_ID, book_index);
+        if(book == nullptr)
+        {
+            //the item is not part of this AuctionPrices' universe
+            return 0;
+        }
+        if(item.tick_size)
+        {
+            if(item.tick_size < 0 || item.max_price < item.min_price)
+            {
+                return 0;
+            }
+            *book = AP::orderbook(item.tick_size, item.min_price, item.max_price, memory);
+        }
+        book->reserve(item.num_orders);
+
+        for(uint32_t k = 0; k < item.num_orders; k++)
+        {
+            snapshot_order order;
+            std::memcpy(&order, orders + k * sizeof(snapshot_order), sizeof(snapshot_order));
+            if(static_cast<uint64_t>(order.id_offset) + order.id_length > item.string_bytes)
+            {
+                return 0;
+            }
+            AP::order_handle handle;
+            book->addNewOrder(std::string_view(strings + order.id_offset, order.id_length), (k < item.num_bids) ? 1 : 2,
+                              order.price, order.quantity, handle);
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,91 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace AP
+{
+    //Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+    //The consumer reads entries in place (readable()/at()) and releases them with pop(), so a run of entries
+    //can be handed to applyBatch() without copying them out first.
+    template<typename T>
+    class spsc_queue
+    {
+        private:
+            std::vector<T> slots;
+            std::size_t mask;
+
+            //head is written by the producer and tail by the consumer. Each side also keeps a private copy of
+            //the other's index, so the shared cache lines are only read when the cached copy says full/empty.
+            alignas(64) std::atomic<std::size_t> head;
+            std::size_t cached_tail;
+            alignas(64) std::atomic<std::size_t> tail;
+            std::size_t cached_head;
+
+        public:
+            //capacity is rounded up to a power of two
+            explicit spsc_queue(std::size_t capacity)
+                : head(0), cached_tail(0), tail(0), cached_head(0)
+            {
+                std::size_t size = 2;
+                while(size < capacity)
+                {
+                    size *= 2;
+                }
+                slots.resize(size);
+                mask = size - 1;
+            }
+
+            spsc_queue(const spsc_queue&) = delete;
+            spsc_queue& operator=(const spsc_queue&) = delete;
+
+            //producer side: returns false if the queue is full
+            bool push(const T& value)
+            {
+                std::size_t h = head.load(std::memory_order_relaxed);
+                if(h - cached_tail == slots.size())
+                {
+                    cached_tail = tail.load(std::memory_order_acquire);
+                    if(h - cached_tail == slots.size())
+                    {
+                        return false;
+                    }
+                }
+                slots[h & mask] = value;
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            //consumer side: number of entries that can be read in place, up to max. The run stops at the end of
+            //the ring, so at(0) ... at(n-1) are contiguous.
+            std::size_t readable(std::size_t max)
+            {
+                std::size_t t = tail.load(std::memory_order_relaxed);
+                if(cached_head == t)
+                {
+                    cached_head = head.load(std::memory_order_acquire);
+                }
+                std::size_t n = cached_head - t;
+                std::size_t to_end = slots.size() - (t & mask);
+                if(n > to_end)
+                {
+                    n = to_end;
+                }
+                return (n < max) ? n : max;
+            }
+
+            const T& at(std::size_t i) const
+            {
+                return slots[(tail.load(std::memory_order_relaxed) + i) & mask];
+            }
+
+            void pop(std::size_t n)
+            {
+                tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+            }
+    };
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include "auction_prices.h"
+#include "journal.h"
+#include "sharded_auction_prices.h"
 #include "flat_hash_map.hpp"
 #include <iostream>
 #include <iomanip>
@@ -8,6 +10,7 @@
 #include <tuple>
 #include <chrono>
 #include <algorithm>
+#include <cstdio>
 
 int main()
 {
@@ -21,6 +24,544 @@ int main()
 
     AuctionHouse.print();
 
+    //Regression checks:
+
+    std::cout<<std::endl<<"Regression checks: "<<std::endl;
+
+    //journaled deletes by handle that drain a pool page; the auction_ID must be journaled after the page is freed
+    {
+        const char* journal_path = "testcases_journal.bin";
+        std::remove(journal_path);
+        AP::journal log;
+        AP::AuctionPrices House;
+        int passed = log.open(journal_path);
+        House.attachJournal(&log);
+        std::vector<AP::order_handle> handles(2000);
+        for(int i=0; i<2000; i++)
+        {
+            passed &= House.addNewOrder("item1", ("auction"+std::to_string(i)).c_str(), 1 + i%2, 100 + i%50, 1, handles[i]);
+        }
+        for(int i=300; i<1999; i++)
+        {
+            passed &= House.deleteOrder(handles[i]);
+        }
+        for(int i=0; i<=50; i++)
+        {
+            passed &= House.deleteOrder(handles[i]);
+        }
+        passed &= House.deleteOrder(handles[1999]);
+        passed &= (House.deleteOrder(handles[1999]) == 0);
+        log.commit();
+        log.close();
+
+        AP::AuctionPrices Replayed;
+        passed &= AP::replayJournal(journal_path, Replayed);
+        std::string live, replayed;
+        {
+            AP::output_sink live_sink(live);
+            House.print(live_sink);
+        }
+        {
+            AP::output_sink replayed_sink(replayed);
+            Replayed.print(replayed_sink);
+        }
+        passed &= (live == replayed);
+        std::remove(journal_path);
+        std::cout<<std::setw(60) << std::left<< "journaled handle deletes draining a page:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //adding a live auction_ID again keeps the resting order and returns its handle, in every layout
+    {
+        AP::AuctionPrices House;
+        House.configureItem("tick_item", 1, 1, 1000);
+        int passed = 1;
+        const char* layouts[2] = {"small_item", "tick_item"};
+        for(const char* item_ID : layouts)
+        {
+            AP::order_handle first, again;
+            passed &= House.addNewOrder(item_ID, "auction1", 1, 100, 5, first);
+            passed &= House.addNewOrder(item_ID, "auction1", 2, 200, 7, again);
+            passed &= (first.book == again.book && first.slot == again.slot && first.generation == again.generation);
+            int price = 0;
+            passed &= House.bestBid(item_ID, price) && price == 100;
+            passed &= (House.bestOffer(item_ID, price) == 0);
+            passed &= House.deleteOrder(again);
+            passed &= (House.deleteOrder(item_ID, "auction1") == 0);
+        }
+        AP::AuctionPrices Hashed(1, 64);
+        for(int i=0; i<64; i++)
+        {
+            Hashed.addNewOrder("hashed_item", ("auction"+std::to_string(i)).c_str(), 1, 100 + i);
+        }
+        AP::order_handle first, again;
+        passed &= Hashed.addNewOrder("hashed_item", "auction64", 1, 50, 1, first);
+        passed &= Hashed.addNewOrder("hashed_item", "auction64", 2, 60, 1, again);
+        passed &= (first.slot == again.slot && first.generation == again.generation);
+        std::cout<<std::setw(60) << std::left<< "duplicate auction_IDs in small, hashed and tick books:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //auction_IDs longer than the 31 characters kept inline are stored on the heap, in every layout
+    {
+        AP::AuctionPrices House;
+        House.configureItem("tick_item", 1, 1, 1000);
+        std::string long_ID = "auction_" + std::string(100, 'x');
+        int passed = 1;
+        const char* layouts[2] = {"small_item", "tick_item"};
+        for(const char* item_ID : layouts)
+        {
+            passed &= House.addNewOrder(item_ID, long_ID, 1, 100);
+            passed &= House.addNewOrder(item_ID, long_ID + "y", 2, 200);
+            passed &= House.deleteOrder(item_ID, long_ID);
+            passed &= (House.deleteOrder(item_ID, long_ID) == 0);
+            passed &= House.deleteOrder(item_ID, long_ID + "y");
+        }
+        for(int i=0; i<64; i++)
+        {
+            passed &= House.addNewOrder("hashed_item", long_ID + std::to_string(i), 1, 100 + i);
+        }
+        AP::book_snapshot view = House.snapshot("hashed_item");
+        for(int i=0; i<64; i++)
+        {
+            passed &= House.deleteOrder("hashed_item", long_ID + std::to_string(i));
+        }
+        uint32_t kept = 0;
+        view.forEachOrder([&](std::string_view auction_ID, int, int, uint32_t)
+        {
+            kept += (auction_ID.substr(0, long_ID.size()) == long_ID);
+        });
+        passed &= (kept == 64);
+        std::cout<<std::setw(60) << std::left<< "auction_IDs longer than 31 characters:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //matching mode: an incoming order trades best price first, then oldest first, and only its remainder rests;
+    //the journal records the trades as deletes and reductions, so replay rebuilds the same book without matching
+    {
+        struct fill_log : AP::fill_listener
+        {
+            std::vector<std::tuple<std::string, int, uint32_t, uint32_t>> fills;
+            void onFill(const AP::fill_event& fill) override
+            {
+                fills.emplace_back(std::string(fill.resting_ID.view()), fill.price, fill.quantity, fill.resting_left);
+            }
+        };
+        const char* journal_path = "testcases_matching.bin";
+        std::remove(journal_path);
+        AP::journal log;
+        fill_log listener;
+        AP::AuctionPrices House;
+        int passed = log.open(journal_path);
+        House.attachJournal(&log);
+        House.attachFillListener(&listener);
+        AP::order_handle handle;
+        passed &= House.addNewOrder("item1", "sell1", 2, 101, 3, handle);
+        passed &= House.addNewOrder("item1", "sell2", 2, 101, 2, handle);
+        passed &= House.addNewOrder("item1", "sell3", 2, 100, 5, handle);
+        passed &= listener.fills.empty();
+
+        //filled on arrival: sell3 at 100 first, then sell1, which arrived before sell2 at 101
+        passed &= House.addNewOrder("item1", "buy1", 1, 101, 6, handle);
+        passed &= (handle.generation == 0);
+        passed &= (listener.fills.size() == 2);
+        passed &= (listener.fills[0] == std::make_tuple(std::string("sell3"), 100, 5u, 0u));
+        passed &= (listener.fills[1] == std::make_tuple(std::string("sell1"), 101, 1u, 2u));
+        passed &= (House.deleteOrder("item1", "buy1") == 0);
+
+        //partly filled: takes the rest of 101 and rests 6 as the best bid
+        listener.fills.clear();
+        passed &= House.addNewOrder("item1", "buy2", 1, 101, 10, handle);
+        passed &= (handle.generation != 0);
+        passed &= (listener.fills.size() == 2);
+        passed &= (listener.fills[0] == std::make_tuple(std::string("sell1"), 101, 2u, 0u));
+        passed &= (listener.fills[1] == std::make_tuple(std::string("sell2"), 101, 2u, 0u));
+        int price = 0;
+        passed &= House.bestBid("item1", price) && price == 101;
+        passed &= (House.bestOffer("item1", price) == 0);
+        passed &= (House.depthAtOrBetter("item1", 1, 101) == 6);
+
+        //a bid below the best offer does not trade
+        listener.fills.clear();
+        passed &= House.addNewOrder("item1", "sell4", 2, 103, 4, handle);
+        passed &= House.addNewOrder("item1", "buy3", 1, 102, 1, handle);
+        passed &= listener.fills.empty();
+        log.commit();
+        log.close();
+
+        AP::AuctionPrices Replayed;
+        passed &= AP::replayJournal(journal_path, Replayed);
+        std::string live, replayed;
+        {
+            AP::output_sink live_sink(live);
+            House.print(live_sink);
+        }
+        {
+            AP::output_sink replayed_sink(replayed);
+            Replayed.print(replayed_sink);
+        }
+        passed &= (live == replayed);
+        std::remove(journal_path);
+        std::cout<<std::setw(60) << std::left<< "matching: fills, partial fills and price-time priority:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //call auction and cumulative depth, in every layout: a crossed book, ties on the executed volume, an
+    //uncrossed book and a book with an empty side
+    {
+        int passed = 1;
+        for(int layout=0; layout<3; layout++)
+        {
+            //the small layout by default, hashed books once the item is sized for 64 orders, or tick-indexed
+            AP::AuctionPrices House(1, layout == 1 ? 64 : 0);
+            if(layout == 2)
+            {
+                const char* items[4] = {"crossed", "buy_surplus", "uncrossed", "bids_only"};
+                for(const char* item_ID : items)
+                {
+                    House.configureItem(item_ID, 1, 1, 1000);
+                }
+            }
+            AP::order_handle handle;
+            House.addNewOrder("crossed", "bid1", 1, 102, 10, handle);
+            House.addNewOrder("crossed", "bid2", 1, 100, 5, handle);
+            House.addNewOrder("crossed", "ask1", 2, 99, 8, handle);
+            House.addNewOrder("crossed", "ask2", 2, 101, 6, handle);
+            House.addNewOrder("buy_surplus", "bid1", 1, 101, 5, handle);
+            House.addNewOrder("buy_surplus", "bid2", 1, 103, 5, handle);
+            House.addNewOrder("buy_surplus", "ask1", 2, 100, 8, handle);
+            House.addNewOrder("uncrossed", "bid1", 1, 99, 5, handle);
+            House.addNewOrder("uncrossed", "ask1", 2, 100, 5, handle);
+            House.addNewOrder("bids_only", "bid1", 1, 100, 5, handle);
+
+            //101 and 102 both execute 10 with a sell surplus of 4: the lower price clears
+            AP::auction_clearing result = {0, 0, 0};
+            passed &= House.clearingPrice("crossed", result);
+            passed &= (result.price == 101 && result.volume == 10 && result.imbalance == -4);
+            //100 and 101 both execute 8 with a buy surplus of 2: the higher price clears
+            passed &= House.clearingPrice("buy_surplus", result);
+            passed &= (result.price == 101 && result.volume == 8 && result.imbalance == 2);
+            result.price = -1;
+            passed &= (House.clearingPrice("uncrossed", result) == 0);
+            passed &= (House.clearingPrice("bids_only", result) == 0);
+            passed &= (result.price == -1);
+
+            passed &= (House.depthAtOrBetter("crossed", 1, 100) == 15);
+            passed &= (House.depthAtOrBetter("crossed", 1, 101) == 10);
+            passed &= (House.depthAtOrBetter("crossed", 1, 103) == 0);
+            passed &= (House.depthAtOrBetter("crossed", 2, 100) == 8);
+            passed &= (House.depthAtOrBetter("crossed", 2, 101) == 14);
+            passed &= (House.depthAtOrBetter("crossed", 2, 98) == 0);
+            passed &= (House.depthAtOrBetter("bids_only", 2, 1000) == 0);
+
+            int price = 0;
+            passed &= House.priceToFill("crossed", 1, 10, price) && price == 102;
+            passed &= House.priceToFill("crossed", 1, 11, price) && price == 100;
+            passed &= House.priceToFill("crossed", 1, 15, price) && price == 100;
+            passed &= (House.priceToFill("crossed", 1, 16, price) == 0);
+            passed &= House.priceToFill("crossed", 2, 8, price) && price == 99;
+            passed &= House.priceToFill("crossed", 2, 9, price) && price == 101;
+            passed &= (House.priceToFill("crossed", 2, 15, price) == 0);
+            passed &= (House.priceToFill("bids_only", 2, 1, price) == 0);
+        }
+
+        //every price from 100 to 106 executes 5 with no imbalance: the middle, 103, is rounded down to the tick grid
+        AP::AuctionPrices House;
+        House.configureItem("tick_item", 2, 100, 200);
+        House.addNewOrder("hashed_item", "bid1", 1, 105);
+        House.addNewOrder("hashed_item", "ask1", 2, 101);
+        House.addNewOrder("tick_item", "bid1", 1, 106);
+        House.addNewOrder("tick_item", "ask1", 2, 100);
+        AP::auction_clearing result = {0, 0, 0};
+        passed &= House.clearingPrice("hashed_item", result);
+        passed &= (result.price == 103 && result.volume == 1 && result.imbalance == 0);
+        passed &= House.clearingPrice("tick_item", result);
+        passed &= (result.price == 102 && result.volume == 1 && result.imbalance == 0);
+        std::cout<<std::setw(60) << std::left<< "clearing price, depth at or better and price to fill:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //amendOrder(), in every layout: a cut in size keeps the order's place and handle; a larger size or a new price
+    //sends it behind its price's queue with a new handle, and the old handle goes stale
+    {
+        int passed = 1;
+        for(int layout=0; layout<3; layout++)
+        {
+            AP::AuctionPrices House(1, layout == 1 ? 64 : 0);
+            if(layout == 2)
+            {
+                House.configureItem("item1", 1, 1, 1000);
+            }
+            AP::order_handle first, second, third;
+            House.addNewOrder("item1", "ask1", 2, 100, 5, first);
+            House.addNewOrder("item1", "ask2", 2, 100, 5, second);
+            House.addNewOrder("item1", "ask3", 2, 101, 5, third);
+            auto queue = [&House]()
+            {
+                AP::depth_order orders[4];
+                uint32_t count = House.topN("item1", 2, orders, 4);
+                std::string order;
+                for(uint32_t i=0; i<count; i++)
+                {
+                    order += std::string(orders[i].auction_ID.view()) + ":" + std::to_string(orders[i].price) + "x" + std::to_string(orders[i].quantity) + " ";
+                }
+                return order;
+            };
+
+            AP::order_handle amended;
+            passed &= House.amendOrder("item1", "ask1", 100, 3, amended);
+            passed &= (amended.book == first.book && amended.slot == first.slot && amended.generation == first.generation);
+            passed &= (queue() == "ask1:100x3 ask2:100x5 ask3:101x5 ");
+
+            passed &= House.amendOrder("item1", "ask1", 100, 6, amended);
+            passed &= (amended.book == first.book && amended.slot == first.slot && amended.generation != first.generation);
+            passed &= (queue() == "ask2:100x5 ask1:100x6 ask3:101x5 ");
+            passed &= (House.deleteOrder(first) == 0);
+            first = amended;
+
+            passed &= House.amendOrder("item1", "ask2", 101, 0, amended);
+            passed &= (amended.slot == second.slot && amended.generation != second.generation);
+            passed &= (queue() == "ask1:100x6 ask3:101x5 ask2:101x5 ");
+            passed &= (House.deleteOrder(second) == 0);
+            second = amended;
+
+            passed &= (House.amendOrder("item1", "ask4", 100, 1) == 0);
+            passed &= House.deleteOrder(first);
+            passed &= House.deleteOrder(second);
+            passed &= (queue() == "ask3:101x5 ");
+        }
+        std::cout<<std::setw(60) << std::left<< "amendOrder queue position and handles:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //topN() by price level and by order, in every layout, stopping at n or at the end of the side
+    {
+        int passed = 1;
+        for(int layout=0; layout<3; layout++)
+        {
+            AP::AuctionPrices House(1, layout == 1 ? 64 : 0);
+            if(layout == 2)
+            {
+                House.configureItem("item1", 1, 1, 1000);
+            }
+            AP::order_handle handle;
+            House.addNewOrder("item1", "bid1", 1, 100, 2, handle);
+            House.addNewOrder("item1", "bid2", 1, 102, 3, handle);
+            House.addNewOrder("item1", "bid3", 1, 100, 4, handle);
+            House.addNewOrder("item1", "bid4", 1, 101, 1, handle);
+            House.addNewOrder("item1", "ask1", 2, 105, 2, handle);
+
+            AP::depth_level levels[8];
+            passed &= (House.topN("item1", 1, levels, 2) == 2);
+            passed &= (levels[0].price == 102 && levels[0].orders == 1 && levels[0].quantity == 3);
+            passed &= (levels[1].price == 101 && levels[1].orders == 1 && levels[1].quantity == 1);
+            passed &= (House.topN("item1", 1, levels, 8) == 3);
+            passed &= (levels[2].price == 100 && levels[2].orders == 2 && levels[2].quantity == 6);
+            passed &= (House.topN("item1", 2, levels, 8) == 1);
+            passed &= (levels[0].price == 105 && levels[0].orders == 1 && levels[0].quantity == 2);
+
+            AP::depth_order orders[8];
+            passed &= (House.topN("item1", 1, orders, 8) == 4);
+            const char* priority[4] = {"bid2", "bid4", "bid1", "bid3"};
+            const int prices[4] = {102, 101, 100, 100};
+            const uint32_t quantities[4] = {3, 1, 2, 4};
+            for(int i=0; i<4; i++)
+            {
+                passed &= (orders[i].auction_ID.view() == priority[i] && orders[i].price == prices[i] && orders[i].quantity == quantities[i]);
+            }
+            passed &= (House.topN("item1", 1, orders, 2) == 2);
+            passed &= (orders[1].auction_ID.view() == "bid4");
+            passed &= (House.topN("item1", 2, orders, 8) == 1);
+
+            passed &= (House.topN("item1", 1, levels, 0) == 0);
+            passed &= (House.topN("item1", 3, levels, 8) == 0);
+            passed &= (House.topN("unknown_item", 1, orders, 8) == 0);
+        }
+        std::cout<<std::setw(60) << std::left<< "topN levels and orders:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //a snapshot file reloads to the same books, in every layout and from a published snapshot; a file of
+    //another version or a truncated one is rejected
+    {
+        const char* snapshot_path = "testcases_snapshot.bin";
+        const char* published_path = "testcases_published.bin";
+        const char* bad_path = "testcases_bad.bin";
+        AP::AuctionPrices House;
+        House.configureItem("tick_item", 5, 100, 500);
+        AP::order_handle handle;
+        for(int i=0; i<40; i++)
+        {
+            House.addNewOrder("hashed_item", ("auction"+std::to_string(i)).c_str(), 1 + i%2, 100 + i%7, 1 + i%3, handle);
+            House.addNewOrder("tick_item", ("auction"+std::to_string(i)).c_str(), 1 + i%2, 200 + 5*(i%7), 1 + i%4, handle);
+        }
+        House.addNewOrder("small_item", "auction1", 1, 100, 3, handle);
+        House.addNewOrder("small_item", "auction2", 2, 105, 4, handle);
+        int passed = House.saveSnapshot(snapshot_path);
+        House.publishSnapshot();
+        passed &= AP::AuctionPrices::saveSnapshot(*House.latestSnapshot(), published_path);
+
+        std::string live;
+        {
+            AP::output_sink live_sink(live);
+            House.print(live_sink);
+        }
+        const char* paths[2] = {snapshot_path, published_path};
+        for(const char* path : paths)
+        {
+            AP::AuctionPrices Loaded;
+            passed &= Loaded.loadSnapshot(path);
+            std::string loaded;
+            {
+                AP::output_sink loaded_sink(loaded);
+                Loaded.print(loaded_sink);
+            }
+            passed &= (live == loaded);
+            AP::depth_order live_orders[64], loaded_orders[64];
+            uint32_t count = House.topN("hashed_item", 1, live_orders, 64);
+            passed &= (Loaded.topN("hashed_item", 1, loaded_orders, 64) == count);
+            for(uint32_t i=0; i<count; i++)
+            {
+                passed &= (live_orders[i].auction_ID.view() == loaded_orders[i].auction_ID.view() && live_orders[i].quantity == loaded_orders[i].quantity);
+            }
+            //the tick layout comes back with its grid
+            passed &= (Loaded.addNewOrder("tick_item", "off_tick", 1, 201) == 0);
+        }
+
+        std::vector<char> file;
+        if(FILE* in = std::fopen(snapshot_path, "rb"))
+        {
+            char chunk[4096];
+            size_t got;
+            while((got = std::fread(chunk, 1, sizeof(chunk), in)) > 0)
+            {
+                file.insert(file.end(), chunk, chunk + got);
+            }
+            std::fclose(in);
+        }
+        passed &= (file.size() > 64);
+        auto rejected = [&](const std::vector<char>& bytes)
+        {
+            FILE* out = std::fopen(bad_path, "wb");
+            if(out == nullptr)
+            {
+                return 0;
+            }
+            std::fwrite(bytes.data(), 1, bytes.size(), out);
+            std::fclose(out);
+            AP::AuctionPrices Loaded;
+            return static_cast<int>(Loaded.loadSnapshot(bad_path) == 0);
+        };
+        //the version follows the 8-byte magic
+        std::vector<char> other_version = file;
+        other_version[8] ^= 1;
+        passed &= rejected(other_version);
+        passed &= rejected(std::vector<char>(file.begin(), file.end() - 16));
+        passed &= rejected(std::vector<char>(file.begin(), file.begin() + 12));
+        std::remove(snapshot_path);
+        std::remove(published_path);
+        std::remove(bad_path);
+        std::cout<<std::setw(60) << std::left<< "snapshot files: round trip, version and truncation:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
+    //ShardedAuctionPrices against one AuctionPrices fed the same fixed stream: every item's ops stay in order
+    //across shards, a snapshot request cuts every shard at the same point, and a queued compaction changes
+    //no order
+    {
+        //every book's orders in priority order, by item
+        auto books = [](const AP::house_snapshot& house, std::map<std::string, std::string>& out)
+        {
+            for(const auto& book : house.books)
+            {
+                std::string& orders = out[book.first];
+                book.second.forEachOrder([&orders](std::string_view auction_ID, int side, int price, uint32_t quantity)
+                {
+                    orders += std::string(auction_ID) + "," + std::to_string(side) + "," + std::to_string(price) + "," + std::to_string(quantity) + " ";
+                });
+            }
+        };
+        AP::AuctionPrices House;
+        AP::ShardedAuctionPrices Sharded(4, 256, false);
+        int passed = 1;
+        for(int i=0; i<4; i++)
+        {
+            std::string item_ID = "item" + std::to_string(i);
+            passed &= House.configureItem(item_ID, 1, 1, 1000);
+            passed &= Sharded.configureItem(item_ID, 1, 1, 1000);
+        }
+
+        std::map<std::string, std::string> single_cut, single_final, sharded_cut, sharded_final;
+        uint64_t single_rejected = 0;
+        uint64_t cut = 0;
+        uint32_t seed = 12345;
+        auto next = [&seed](uint32_t range)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) % range;
+        };
+        for(int op=0; op<40000; op++)
+        {
+            std::string item_ID = "item" + std::to_string(next(24));
+            std::string auction_ID = "order" + std::to_string(next(40));
+            int price = 90 + static_cast<int>(next(20));
+            uint32_t quantity = 1 + next(5);
+            uint32_t action = next(10);
+            int status;
+            if(action < 5)
+            {
+                int side = 1 + static_cast<int>(next(2));
+                AP::order_handle handle;
+                status = House.addNewOrder(item_ID, auction_ID, side, price, quantity, handle);
+                Sharded.addNewOrder(item_ID, auction_ID, side, price, quantity);
+            }
+            else if(action < 7)
+            {
+                status = House.deleteOrder(item_ID, auction_ID);
+                Sharded.deleteOrder(item_ID, auction_ID);
+            }
+            else if(action < 8)
+            {
+                status = House.reduceOrder(item_ID, auction_ID, quantity);
+                Sharded.reduceOrder(item_ID, auction_ID, quantity);
+            }
+            else
+            {
+                status = House.amendOrder(item_ID, auction_ID, price, action == 8 ? 0 : quantity);
+                Sharded.amendOrder(item_ID, auction_ID, price, action == 8 ? 0 : quantity);
+            }
+            single_rejected += (status == 0);
+            if(op == 15000)
+            {
+                books(House.snapshot(), single_cut);
+                cut = Sharded.requestSnapshot();
+            }
+            if(op == 25000)
+            {
+                House.compact();
+                Sharded.compact();
+            }
+        }
+        books(House.snapshot(), single_final);
+        //the cut is still the shards' latest snapshot: no other was requested since
+        Sharded.flush();
+        for(uint32_t i=0; i<Sharded.shardCount(); i++)
+        {
+            std::shared_ptr<const AP::house_snapshot> shard = Sharded.latestSnapshot(i);
+            passed &= (shard != nullptr && shard->sequence == cut);
+            if(shard)
+            {
+                books(*shard, sharded_cut);
+            }
+        }
+        uint64_t last = Sharded.requestSnapshot();
+        Sharded.flush();
+        for(uint32_t i=0; i<Sharded.shardCount(); i++)
+        {
+            std::shared_ptr<const AP::house_snapshot> shard = Sharded.latestSnapshot(i);
+            passed &= (shard != nullptr && shard->sequence == last);
+            if(shard)
+            {
+                books(*shard, sharded_final);
+            }
+        }
+        passed &= (single_cut == sharded_cut && single_final == sharded_final);
+        passed &= (single_rejected > 0 && Sharded.rejectedOrders() == single_rejected);
+        std::cout<<std::setw(60) << std::left<< "sharded front-end against a single AuctionPrices:"<<(passed ? "ok" : "FAILED")<<std::endl;
+    }
+
     //Time calcs:
 
     std::cout<<std::endl<<std::endl;
@@ -58,7 +599,7 @@ int main()
     std::cout<<std::setw(20) << std::left <<test_size<<std::setw(60) << std::left<< "insertion - <string,int>:"<<std::setw(20) << std::left <<std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(endTime - startTime).count()<<" ms"<<std::endl; 
 
     //Insertion performance for flat_hash_map
-    AP::AuctionPrices House2;
+    AP::AuctionPrices House2(1, test_size);
     std::string base_item_ID = "item3";
 
     startTime = std::chrono::high_resolution_clock::now();
@@ -116,7 +657,7 @@ int main()
     std::cout<<std::endl;
 
     //Combined insert-delete <int,int>:
-    AP::AuctionPrices House3;
+    AP::AuctionPrices House3(1, test_size);
     startTime = std::chrono::high_resolution_clock::now();
     for(int i=0;i<test_size/2;i++)
     {